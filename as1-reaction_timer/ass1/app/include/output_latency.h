@@ -0,0 +1,61 @@
+#ifndef OUTPUT_LATENCY_H
+#define OUTPUT_LATENCY_H
+
+// Measures how long it takes from starting an LED write until the LED is
+// actually lit, so reaction times can be reported from the moment the
+// light appeared instead of the moment led_set() returned.
+//
+// Two ways to measure:
+//  - sysfs:      times the brightness write itself (no extra hardware).
+//                The game already measures from the write's start, so
+//                this is informational only and never corrects anything.
+//  - photodiode: a photodiode on a spare ADC channel watches the LED, and
+//                the latency is the first ADC sample that sees it lit
+//
+// Each LED gets its own numbers (the red and green triggers need not be
+// equally fast); arrays below are indexed by led_t.
+
+#include "hal/adc.h"
+#include "hal/led.h"
+
+#include <stdbool.h>
+
+#define OUTPUT_LATENCY_FILE    "output_latency.cal"  // default place to store it
+#define OUTPUT_LATENCY_SAMPLES 200
+#define OUTPUT_LATENCY_LEDS    2     // LED_GREEN, LED_RED
+
+typedef struct {
+    int       count;       // samples taken (0 = not calibrated)
+    long long min_ns;
+    long long p50_ns;      // what gets subtracted from reaction times (photodiode)
+    long long p95_ns;
+    long long max_ns;
+    long long mean_ns;
+    char      method[16];  // "sysfs" or "photodiode"
+} output_latency_t;
+
+// Fills 'out' from 'samples' timed writes of 'which'. Returns 0 or -1.
+int output_latency_calibrate_sysfs(led_t which, int samples, output_latency_t *out);
+
+// Same, watching the LED through logical channel 'ch' of 'adc'.
+int output_latency_calibrate_photodiode(led_t which, adc_dev_t *adc, int ch,
+                                        int samples, output_latency_t *out);
+
+// Saves / loads every LED's distribution as a small key=value text file
+// ("green.p50_ns=..."; LEDs with count 0 are left out). A file from before
+// per-LED calibration has unprefixed keys: those were measured on green.
+// 'path' NULL means $OUTPUT_LATENCY_FILE or OUTPUT_LATENCY_FILE.
+// load returns 0 if at least one LED is calibrated.
+int output_latency_save(const char *path, const output_latency_t lat[OUTPUT_LATENCY_LEDS]);
+int output_latency_load(const char *path, output_latency_t lat[OUTPUT_LATENCY_LEDS]);
+
+// True if reaction times should be corrected by lat->p50_ns: only a
+// photodiode calibration saw the light itself.
+bool output_latency_corrects(const output_latency_t *lat);
+
+// "green" / "red"
+const char *output_latency_led_name(led_t which);
+
+void output_latency_print(led_t which, const output_latency_t *lat);
+
+#endif  // OUTPUT_LATENCY_H
@@ -0,0 +1,231 @@
+/*
+ * Output-latency calibration for the reaction timer.
+ * Every sample turns the LED off, lets it settle, then times one "on"
+ * write. The sorted samples give the distribution; the median is the
+ * number the game subtracts from each reaction time.
+ */
+
+#include "output_latency.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal/timebase.h"
+
+#define SETTLE_MS          20        // LED fully dark/lit before each sample
+#define PHOTO_TIMEOUT_NS   (100 * NS_PER_MS)  // give up on one sample after 100ms
+
+static int cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// turns the raw samples into the stored summary
+static void summarize(long long *v, int n, const char *method, output_latency_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    snprintf(out->method, sizeof(out->method), "%s", method);
+    if (n <= 0)
+        return;
+
+    qsort(v, (size_t)n, sizeof(v[0]), cmp_ll);
+    long long sum = 0;
+    for (int i = 0; i < n; ++i)
+        sum += v[i];
+
+    out->count   = n;
+    out->min_ns  = v[0];
+    out->p50_ns  = v[n / 2];
+    out->p95_ns  = v[(n * 95) / 100 < n ? (n * 95) / 100 : n - 1];
+    out->max_ns  = v[n - 1];
+    out->mean_ns = sum / n;
+}
+
+static const char *resolve_path(const char *path)
+{
+    if (path)
+        return path;
+    const char *env = getenv("OUTPUT_LATENCY_FILE");
+    return (env && *env) ? env : OUTPUT_LATENCY_FILE;
+}
+
+int output_latency_calibrate_sysfs(led_t which, int samples, output_latency_t *out)
+{
+    if (samples <= 0)
+        samples = OUTPUT_LATENCY_SAMPLES;
+    long long *v = malloc(sizeof(*v) * (size_t)samples);
+    if (!v)
+        return -1;
+
+    for (int i = 0; i < samples; ++i) {
+        led_set(which, false);
+        sleep_ms(SETTLE_MS);
+
+        nsec_t t0 = now_ns();
+        led_set(which, true);
+        v[i] = ns_since(t0);
+    }
+    led_set(which, false);
+
+    summarize(v, samples, "sysfs", out);
+    free(v);
+    return 0;
+}
+
+// average of a few readings so one noisy sample doesn't move the threshold
+static int settled_level(adc_dev_t *adc, int ch)
+{
+    int sum = 0;
+    for (int i = 0; i < 8; ++i) {
+        adc_sample_t s;
+        if (adc_read(adc, ch, &s) != 0 || s.raw < 0)
+            return -1;
+        sum += s.raw;
+    }
+    return sum / 8;
+}
+
+int output_latency_calibrate_photodiode(led_t which, adc_dev_t *adc, int ch,
+                                        int samples, output_latency_t *out)
+{
+    if (!adc)
+        return -1;
+    if (samples <= 0)
+        samples = OUTPUT_LATENCY_SAMPLES;
+
+    // find out what "dark" and "lit" look like through the photodiode
+    led_set(which, false);
+    sleep_ms(SETTLE_MS * 5);
+    int dark = settled_level(adc, ch);
+    led_set(which, true);
+    sleep_ms(SETTLE_MS * 5);
+    int lit = settled_level(adc, ch);
+    led_set(which, false);
+
+    if (dark < 0 || lit < 0 || abs(lit - dark) < 50) {
+        fprintf(stderr, "Photodiode can't see the LED (dark=%d lit=%d).\n", dark, lit);
+        return -1;
+    }
+    int threshold = dark + (lit - dark) / 2;
+    int rising    = lit > dark;
+
+    long long *v = malloc(sizeof(*v) * (size_t)samples);
+    if (!v)
+        return -1;
+
+    int n = 0;
+    for (int i = 0; i < samples; ++i) {
+        led_set(which, false);
+        sleep_ms(SETTLE_MS);
+
+        nsec_t t0 = now_ns();
+        led_set(which, true);
+
+        // poll the ADC until the light crosses the half-way level; the
+        // sample's own transfer timestamp is the moment it was seen
+        for (;;) {
+            adc_sample_t s;
+            if (adc_read(adc, ch, &s) != 0)
+                break;
+            if (rising ? (s.raw >= threshold) : (s.raw <= threshold)) {
+                v[n++] = s.t_ns - t0;
+                break;
+            }
+            if (s.t_ns - t0 > PHOTO_TIMEOUT_NS)
+                break;   // missed this one; don't count it
+        }
+    }
+    led_set(which, false);
+
+    summarize(v, n, "photodiode", out);
+    free(v);
+    return (n > 0) ? 0 : -1;
+}
+
+const char *output_latency_led_name(led_t which)
+{
+    return (which == LED_RED) ? "red" : "green";
+}
+
+int output_latency_save(const char *path, const output_latency_t lat[OUTPUT_LATENCY_LEDS])
+{
+    path = resolve_path(path);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror("save output latency");
+        return -1;
+    }
+    for (int i = 0; i < OUTPUT_LATENCY_LEDS; ++i) {
+        const output_latency_t *l = &lat[i];
+        const char *led = output_latency_led_name((led_t)i);
+        if (l->count <= 0)
+            continue;
+        fprintf(f, "%s.method=%s\n", led, l->method);
+        fprintf(f, "%s.count=%d\n", led, l->count);
+        fprintf(f, "%s.min_ns=%lld\n", led, l->min_ns);
+        fprintf(f, "%s.p50_ns=%lld\n", led, l->p50_ns);
+        fprintf(f, "%s.p95_ns=%lld\n", led, l->p95_ns);
+        fprintf(f, "%s.max_ns=%lld\n", led, l->max_ns);
+        fprintf(f, "%s.mean_ns=%lld\n", led, l->mean_ns);
+    }
+    fclose(f);
+    return 0;
+}
+
+int output_latency_load(const char *path, output_latency_t lat[OUTPUT_LATENCY_LEDS])
+{
+    memset(lat, 0, sizeof(lat[0]) * OUTPUT_LATENCY_LEDS);
+    FILE *f = fopen(resolve_path(path), "r");
+    if (!f)
+        return -1;   // not calibrated yet; not an error worth printing
+
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        char name[32];
+        char val[64];
+        if (sscanf(line, "%31[^=]=%63s", name, val) != 2)
+            continue;
+
+        // "red.p50_ns"; no prefix = the old green-only file
+        output_latency_t *l = &lat[LED_GREEN];
+        const char *key = name;
+        char *dot = strchr(name, '.');
+        if (dot) {
+            *dot = '\0';
+            key  = dot + 1;
+            if      (strcmp(name, "green") == 0) l = &lat[LED_GREEN];
+            else if (strcmp(name, "red")   == 0) l = &lat[LED_RED];
+            else continue;
+        }
+        if      (strcmp(key, "method")  == 0) snprintf(l->method, sizeof(l->method), "%.15s", val);
+        else if (strcmp(key, "count")   == 0) l->count   = atoi(val);
+        else if (strcmp(key, "min_ns")  == 0) l->min_ns  = atoll(val);
+        else if (strcmp(key, "p50_ns")  == 0) l->p50_ns  = atoll(val);
+        else if (strcmp(key, "p95_ns")  == 0) l->p95_ns  = atoll(val);
+        else if (strcmp(key, "max_ns")  == 0) l->max_ns  = atoll(val);
+        else if (strcmp(key, "mean_ns") == 0) l->mean_ns = atoll(val);
+    }
+    fclose(f);
+    for (int i = 0; i < OUTPUT_LATENCY_LEDS; ++i)
+        if (lat[i].count > 0)
+            return 0;
+    return -1;
+}
+
+bool output_latency_corrects(const output_latency_t *lat)
+{
+    return lat->count > 0 && strcmp(lat->method, "photodiode") == 0;
+}
+
+void output_latency_print(led_t which, const output_latency_t *lat)
+{
+    printf("%s LED output latency (%s, %d samples): min %lldus, median %lldus, "
+           "p95 %lldus, max %lldus%s\n",
+           output_latency_led_name(which), lat->method, lat->count,
+           lat->min_ns / 1000, lat->p50_ns / 1000,
+           lat->p95_ns / 1000, lat->max_ns / 1000,
+           output_latency_corrects(lat) ? "" : " (write time only, no correction)");
+}
@@ -2,38 +2,291 @@
  * My reaction timer game for the BeagleY-AI board.
  * Uses LEDs and joystick — pretty much what the assignment asks for.
  * Everything below runs on Linux (Debian ARM) using HAL drivers I wrote earlier.
+ *
+ * While it runs, a control socket ($REACTION_CTL, default
+ * /tmp/reaction_timer.ctl) answers queries from another terminal:
+ *   socat - UNIX-CONNECT:/tmp/reaction_timer.ctl
+ * It's served from the game's sleeps, between joystick reads, so a query
+ * never delays the read that stops the clock.
  */
 
-#define _POSIX_C_SOURCE 200809L   // needed for nanosleep() and clock_gettime()
-
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "hal/ctl.h"
 #include "hal/led.h"
 #include "hal/joystick.h"
+#include "hal/timebase.h"
+#include "hal/evlog.h"
+#include "output_latency.h"
+
+#define CTL_PATH      "/tmp/reaction_timer.ctl"   // $REACTION_CTL overrides, "" = off
+#define HISTORY_LEN   64                          // reaction times kept for "latency"
+
+// what the control socket can see of the game
+typedef struct {
+    int       rounds, correct, wrong, too_soon;
+    long long best_ms, last_ms;
+    long long history[HISTORY_LEN];   // newest at head - 1
+    int       head, n;
+    const char *phase;
+} game_t;
+
+static game_t  g_game = { .phase = "starting" };
+static ctl_t  *g_ctl  = NULL;
+
+// sleep that also answers the control socket
+static void wait_ms(long long ms)
+{
+    ctl_wait_until(g_ctl, now_ns() + ms * NS_PER_MS);
+}
+
+static void game_record(long long ms)
+{
+    g_game.last_ms = ms;
+    g_game.history[g_game.head] = ms;
+    g_game.head = (g_game.head + 1) % HISTORY_LEN;
+    if (g_game.n < HISTORY_LEN)
+        g_game.n++;
+}
+
+static int cmd_status(ctl_t *c, int argc, char **argv, void *ctx)
+{
+    (void)argc; (void)argv; (void)ctx;
+    ctl_printf(c, "phase %s rounds %d correct %d wrong %d too_soon %d\n", g_game.phase,
+               g_game.rounds, g_game.correct, g_game.wrong, g_game.too_soon);
+    ctl_printf(c, "best_ms %lld last_ms %lld log_dropped %llu\n",
+               g_game.best_ms, g_game.last_ms, evlog_dropped());
+    return 0;
+}
+
+// one fresh read of every ADC channel the joystick uses
+static int cmd_joystick(ctl_t *c, int argc, char **argv, void *ctx)
+{
+    (void)argc; (void)argv; (void)ctx;
+    static const char *dirs[] = { "none", "up", "down", "left", "right" };
+    adc_sample_t all[ADC_MAX_CHANNELS];
+    if (!joystick_adc() || adc_read_all(joystick_adc(), all) != 0) {
+        ctl_error(c, "ADC not answering");
+        return -1;
+    }
+    for (int ch = 0; ch < 2; ++ch)
+        ctl_printf(c, "ch%d raw %d permille %d\n", ch, all[ch].raw, all[ch].permille);
+    ctl_printf(c, "direction %s\n", dirs[joystick_direction()]);
+    return 0;
+}
 
-// quick helper to pause for a few ms without using usleep() directly
-static void sleep_ms(int ms)
+static int cmd_latency(ctl_t *c, int argc, char **argv, void *ctx)
 {
-    struct timespec req;
-    req.tv_sec  = ms / 1000;               // seconds part
-    req.tv_nsec = (ms % 1000) * 1000000L;  // remainder in nanoseconds
-    nanosleep(&req, NULL);                 // actually sleep
+    (void)ctx;
+    int n = (argc > 1) ? atoi(argv[1]) : 10;
+    if (n <= 0 || n > HISTORY_LEN) {
+        ctl_error(c, "N is 1..%d", HISTORY_LEN);
+        return -1;
+    }
+    if (n > g_game.n)
+        n = g_game.n;
+    for (int i = 0; i < n; ++i)
+        ctl_printf(c, "%lld\n", g_game.history[(g_game.head - 1 - i + HISTORY_LEN) % HISTORY_LEN]);
+    return 0;
+}
+
+// led <green|red|sysfs name|id> <0..1000>
+static int cmd_led(ctl_t *c, int argc, char **argv, void *ctx)
+{
+    (void)ctx;
+    if (argc != 3) {
+        ctl_error(c, "usage: led <green|red|name|id> <0..%d>", LED_LEVEL_MAX);
+        return -1;
+    }
+    int id = !strcmp(argv[1], "green") ? led_id(LED_GREEN)
+           : !strcmp(argv[1], "red")   ? led_id(LED_RED)
+           : led_find(argv[1]);
+    if (id < 0 && argv[1][0] >= '0' && argv[1][0] <= '9')
+        id = atoi(argv[1]);
+    int level = atoi(argv[2]);
+    if (id < 0 || id >= led_count() || level < 0 || level > LED_LEVEL_MAX) {
+        ctl_error(c, "no such LED or level");
+        return -1;
+    }
+    led_set_level_id(id, level);
+    ctl_printf(c, "%s %d\n", led_name(id), led_get_level_id(id));
+    return 0;
 }
 
-// gives me a running timer in milliseconds that doesn’t reset
-static long long now_ms(void)
+static int cmd_reset(ctl_t *c, int argc, char **argv, void *ctx)
 {
-    struct timespec t;
-    clock_gettime(CLOCK_MONOTONIC, &t);
-    return (long long)t.tv_sec * 1000LL + t.tv_nsec / 1000000LL;
+    (void)c; (void)argc; (void)argv; (void)ctx;
+    const char *phase = g_game.phase;
+    memset(&g_game, 0, sizeof(g_game));
+    g_game.phase = phase;
+    return 0;
 }
 
-int main(void)
+static void open_ctl(void)
 {
-    srand((unsigned)time(NULL));   // seed RNG for random delays
+    const char *path = getenv("REACTION_CTL");
+    if (!path)
+        path = CTL_PATH;
+    if (!*path || !(g_ctl = ctl_open(path)))
+        return;   // the game works fine without it
+    ctl_register(g_ctl, "status",   "phase, round counts, best and last time", cmd_status, NULL);
+    ctl_register(g_ctl, "joystick", "read the ADC now: raw, permille, direction", cmd_joystick, NULL);
+    ctl_register(g_ctl, "latency",  "[N] last N reaction times in ms", cmd_latency, NULL);
+    ctl_register(g_ctl, "led",      "<green|red|name|id> <0..1000> set an LED", cmd_led, NULL);
+    ctl_register(g_ctl, "reset",    "forget the scores so far", cmd_reset, NULL);
+}
+
+// calibration mode: measure each LED's latency, store it, and quit
+//   reaction_timer --calibrate [samples]                    (times the sysfs writes)
+//   reaction_timer --calibrate-adc <ch> [samples] [led]     (photodiode on spare ADC channel)
+// The photodiode sees one LED at a time (green unless 'led' is "red");
+// the other LED keeps what the file already had for it.
+static int run_calibration(int argc, char **argv)
+{
+    output_latency_t lat[OUTPUT_LATENCY_LEDS];
+    int rc = 0;
+
+    (void)output_latency_load(NULL, lat);
+    led_init();
+    if (strcmp(argv[1], "--calibrate-adc") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "usage: %s --calibrate-adc <channel> [samples] [green|red]\n", argv[0]);
+            led_cleanup();
+            return 1;
+        }
+        // photodiode sits on a spare input of the joystick's ADC board
+        adc_config_t cfg;
+        adc_config_default(&cfg, 0, 0);
+        cfg.n_channels     = 1;
+        cfg.channel_map[0] = atoi(argv[2]);
+        adc_dev_t *adc = adc_open(&cfg);
+        int samples = (argc > 3) ? atoi(argv[3]) : OUTPUT_LATENCY_SAMPLES;
+        led_t which = (argc > 4 && strcmp(argv[4], "red") == 0) ? LED_RED : LED_GREEN;
+        rc = output_latency_calibrate_photodiode(which, adc, 0, samples, &lat[which]);
+        adc_close(adc);
+    } else {
+        int samples = (argc > 2) ? atoi(argv[2]) : OUTPUT_LATENCY_SAMPLES;
+        for (int i = 0; i < OUTPUT_LATENCY_LEDS && rc == 0; ++i)
+            rc = output_latency_calibrate_sysfs((led_t)i, samples, &lat[i]);
+    }
+    led_cleanup();
+
+    if (rc != 0) {
+        fprintf(stderr, "Calibration failed.\n");
+        return 1;
+    }
+    for (int i = 0; i < OUTPUT_LATENCY_LEDS; ++i)
+        if (lat[i].count > 0)
+            output_latency_print((led_t)i, &lat[i]);
+    return (output_latency_save(NULL, lat) == 0) ? 0 : 1;
+}
+
+// scope mode: stream the joystick ADC flat out and report once a second
+//   reaction_timer --scope [seconds] [file.csv]
+// The CSV has one row per frame: time (ns, evenly spread over the block's
+// ioctl) and the raw reading of every channel.
+static int run_scope(int argc, char **argv)
+{
+    int seconds = (argc > 2) ? atoi(argv[2]) : 5;
+    FILE *csv = NULL;
+    if (argc > 3 && !(csv = fopen(argv[3], "w"))) {
+        perror(argv[3]);
+        return 1;
+    }
+    if (joystick_init() != 0 || joystick_capture_start(0) != 0) {
+        fprintf(stderr, "Scope: can't start the ADC capture.\n");
+        joystick_cleanup();
+        if (csv)
+            fclose(csv);
+        return 1;
+    }
+
+    static adc_capture_block_t b;
+    int  lo[ADC_MAX_CHANNELS], hi[ADC_MAX_CHANNELS];
+    long long sum[ADC_MAX_CHANNELS], n = 0;
+    nsec_t t_end = now_ns() + seconds * NS_PER_SEC, t_report = now_ns() + NS_PER_SEC;
+    int n_ch = 0;
+
+    for (int c = 0; c < ADC_MAX_CHANNELS; ++c) { lo[c] = ADC_FULL_SCALE; hi[c] = 0; sum[c] = 0; }
+    while (now_ns() < t_end) {
+        int rc;
+        while ((rc = adc_capture_read(&b)) == 1) {
+            n_ch = b.n_channels;
+            long long span = b.t_end_ns - b.t_start_ns;
+            for (int f = 0; f < b.frames; ++f) {
+                const unsigned short *row = &b.raw[f * n_ch];
+                if (csv) {
+                    fprintf(csv, "%lld", b.t_start_ns + span * f / b.frames);
+                    for (int c = 0; c < n_ch; ++c)
+                        fprintf(csv, ",%u", row[c]);
+                    fputc('\n', csv);
+                }
+                for (int c = 0; c < n_ch; ++c) {
+                    if (row[c] < lo[c]) lo[c] = row[c];
+                    if (row[c] > hi[c]) hi[c] = row[c];
+                    sum[c] += row[c];
+                }
+            }
+            n += b.frames;
+        }
+        if (rc < 0)
+            break;
+
+        if (now_ns() >= t_report) {
+            t_report += NS_PER_SEC;
+            adc_capture_stats_t st;
+            adc_capture_get_stats(&st);
+            printf("%.0f frames/s, bus busy %.0f%%, gap mean %lld us max %lld us, %llu dropped\n",
+                   st.frame_hz, 100.0 * st.duty, ns_to_us(st.mean_gap_ns),
+                   ns_to_us(st.max_gap_ns), st.dropped);
+            for (int c = 0; c < n_ch && n > 0; ++c) {
+                printf("  ch%d min %d max %d mean %lld\n", c, lo[c], hi[c], sum[c] / n);
+                lo[c] = ADC_FULL_SCALE; hi[c] = 0; sum[c] = 0;
+            }
+            n = 0;
+        }
+        sleep_ms(5);   // the ring holds ADC_CAPTURE_BLOCKS ioctls' worth
+    }
+    joystick_capture_stop();
+
+    adc_capture_stats_t st;
+    adc_capture_get_stats(&st);
+    printf("Scope: %llu blocks of %d conversions (spidev bufsiz %d) at %u Hz SPI\n",
+           st.blocks, st.xfers_per_ioctl, st.bufsiz, st.speed_hz);
+    printf("       %.0f frames/s overall, %llu blocks dropped, %llu SPI errors\n",
+           st.frame_hz, st.dropped, st.errors);
+    joystick_cleanup();
+    if (csv)
+        fclose(csv);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strncmp(argv[1], "--calibrate", 11) == 0)
+        return run_calibration(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--scope") == 0)
+        return run_scope(argc, argv);
+
+    // seed RNG for random delays (fixed in simulation so runs repeat)
+    srand(timebase_is_virtual() ? 351u : (unsigned)time(NULL));
+
+    // all timing goes through hal/timebase; complain once if it's slow
+    timebase_report_t tb;
+    if (timebase_init(&tb) != 0)
+        timebase_print(&tb, "Warning:");
+
+    // LED output latencies from a previous --calibrate run, if there is one
+    output_latency_t lat[OUTPUT_LATENCY_LEDS];
+    if (output_latency_load(NULL, lat) == 0) {
+        for (int i = 0; i < OUTPUT_LATENCY_LEDS; ++i)
+            if (lat[i].count > 0)
+                output_latency_print((led_t)i, &lat[i]);
+    }
 
     // try to start joystick first — if it fails, just stop here
     if (joystick_init() != 0) {
@@ -44,111 +297,143 @@ int main(void)
     // initialize both LEDs (turn off triggers, start dark)
     led_init();
 
-    // intro text
-    printf("Hello embedded world, from Alidad!\n");
-    printf("When the LEDs light up, press the joystick in that direction!\n");
-    printf("(Press LEFT or RIGHT to exit)\n");
+    open_ctl();
 
-    long long best_ms = 0; // track my best (fastest) reaction time
+    // game events only queue a record from here on; the console writes
+    // happen on the logger thread so they never delay the timed section
+    evlog_start(stdout, false);
+
+    // intro text
+    EVLOG("Hello embedded world, from Alidad!\n");
+    EVLOG("When the LEDs light up, press the joystick in that direction!\n");
+    EVLOG("(Press LEFT or RIGHT to exit)\n");
 
     // main game loop — runs until quit or timeout
     while (1) {
-        printf("\nGet ready...\n");
+        EVLOG("\nGet ready...\n");
+        g_game.phase = "get_ready";
 
         // flash both LEDs back and forth 4 times so user can get ready
-        for (int i = 0; i < 4; ++i) {
-            led_set(LED_GREEN, true);
-            sleep_ms(250);
-            led_set(LED_GREEN, false);
-
-            led_set(LED_RED, true);
-            sleep_ms(250);
-            led_set(LED_RED, false);
+        // (one frame every 250ms; each swap happens in a single commit)
+        led_frame_t frame;
+        led_frame_set_rate(4);
+        for (int i = 0; i < 8; ++i) {
+            led_frame_clear(&frame);
+            led_frame_set(&frame, (i & 1) ? LED_RED : LED_GREEN, true);
+            led_frame_commit(&frame);
         }
+        led_frame_clear(&frame);
+        led_frame_commit(&frame);   // waits out the last 250ms, then dark
+        led_frame_set_rate(0);
 
         // make sure joystick is centered before we start counting
         int told_release = 0;
         while (joystick_active()) {
             if (!told_release) {
-                printf("Please let go of joystick.\n");
+                EVLOG("Please let go of joystick.\n");
                 told_release = 1;
             }
-            sleep_ms(50);
+            wait_ms(50);
         }
 
         // wait for random time between 0.5–3s (adds suspense)
         int delay_ms = 500 + (rand() % 2501);
-        sleep_ms(delay_ms);
+        g_game.phase = "delay";
+        wait_ms(delay_ms);
 
         // if user cheats and presses early, call them out and restart
         if (joystick_active()) {
-            printf("Too soon!\n");
+            EVLOG("Too soon!\n");
+            g_game.too_soon++;
             continue;
         }
 
         // randomly choose which LED to show (up = green, down = red)
         int pick_up = rand() & 1;
-        if (pick_up) {
-            printf("Press UP now!\n");
-            led_set(LED_GREEN, true);
-        } else {
-            printf("Press DOWN now!\n");
-            led_set(LED_RED, true);
-        }
+        EVLOG(pick_up ? "Press UP now!\n" : "Press DOWN now!\n");
 
-        // start timing how long user takes to react
+        // start timing how long user takes to react; with a photodiode
+        // calibration of this LED the reaction is measured from when the
+        // write started plus the time it needs to light up, otherwise from
+        // when led_set() returns
+        led_t shown = pick_up ? LED_GREEN : LED_RED;
+        nsec_t t_write_ns = now_ns();
+        led_set(shown, true);
         long long t0 = now_ms();
         js_dir_t dir = JS_NONE;
+        g_game.phase = "timing";
 
         // give them up to 5 seconds to react
         while ((now_ms() - t0) < 5000) {
             dir = joystick_direction();
             if (dir != JS_NONE)
                 break;   // joystick moved — got a direction
-            sleep_ms(30); // check about 30 times per second
+            wait_ms(30); // check about 30 times per second
         }
 
         long long elapsed = now_ms() - t0;
+        if (output_latency_corrects(&lat[shown])) {
+            nsec_t lit_ns = t_write_ns + lat[shown].p50_ns;   // when the light appeared
+            elapsed = ns_to_ms(ns_since(lit_ns));
+            if (elapsed < 0)
+                elapsed = 0;
+        }
         led_all_off();   // LEDs off before showing results
+        g_game.phase = "result";
 
         // if 5 seconds pass and nothing was pressed, bail out
         if (dir == JS_NONE) {
-            printf("No input within 5000ms; quitting!\n");
+            EVLOG("No input within 5000ms; quitting!\n");
             break;
         }
 
         // left or right is my quit shortcut
         if (dir == JS_LEFT || dir == JS_RIGHT) {
-            printf("User selected to quit.\n");
+            EVLOG("User selected to quit.\n");
             break;
         }
 
         // figure out if the player pressed the correct direction
         int correct = (pick_up && dir == JS_UP) || (!pick_up && dir == JS_DOWN);
+        g_game.rounds++;
         if (correct) {
-            printf("Correct!\n");
+            EVLOG("Correct!\n");
+            g_game.correct++;
+            game_record(elapsed);
 
             // if this attempt was faster than the last best, update it
-            if (best_ms == 0 || elapsed < best_ms) {
-                best_ms = elapsed;
-                printf("New best time!\n");
+            if (g_game.best_ms == 0 || elapsed < g_game.best_ms) {
+                g_game.best_ms = elapsed;
+                EVLOG("New best time!\n");
             }
 
             // show the numbers for this round
-            printf("Your reaction time was %lldms; best so far in game is %lldms.\n",
-                   elapsed, best_ms);
+            EVLOG("Your reaction time was %lldms; best so far in game is %lldms.\n",
+                   elapsed, g_game.best_ms);
+
+            // show the speed as brightness for a moment: ~150ms (or faster)
+            // is full brightness, 1s or slower is a dim glow
+            long long lvl = LED_LEVEL_MAX - ((elapsed - 150) * LED_LEVEL_MAX) / 850;
+            if (lvl > LED_LEVEL_MAX)     lvl = LED_LEVEL_MAX;
+            if (lvl < LED_LEVEL_MAX / 20) lvl = LED_LEVEL_MAX / 20;
+            led_set_level(LED_GREEN, (int)lvl);
+            wait_ms(600);
+            led_set(LED_GREEN, false);
 
             // blink green LED 5 times in one second (each blink = 100ms on/off)
             led_blink(LED_GREEN, 5, 100);
         } else {
-            printf("Incorrect.\n");
+            EVLOG("Incorrect.\n");
+            g_game.wrong++;
             // if user pressed wrong way, flash red instead
             led_blink(LED_RED, 5, 100);
         }
     }
 
     // cleanup before exiting (turn LEDs off and close SPI)
+    ctl_close(g_ctl);
     led_cleanup();
     joystick_cleanup();
+    evlog_stop();
     return 0;
 }
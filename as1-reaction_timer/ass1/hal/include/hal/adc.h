@@ -0,0 +1,147 @@
+#ifndef HAL_ADC_H
+#define HAL_ADC_H
+
+// Multi-device driver for 12-bit SPI ADCs (MCP3208 style) on spidev.
+// Each ADC board is opened as its own instance (bus + chip-select) with its
+// own channel map, calibration and sampling rate. Instances that ask for a
+// sampling rate are read by ONE shared sampler thread, which schedules the
+// transfers round-robin on absolute deadlines so every board gets evenly
+// spaced samples. Instances with sample_hz == 0 are read on demand instead.
+
+#include <stdbool.h>
+
+#define ADC_MAX_DEVICES   4
+#define ADC_MAX_CHANNELS  8
+#define ADC_INPUTS        8        // physical inputs, CH0-CH7
+#define ADC_FULL_SCALE    4095     // 12-bit full-scale (0-4095)
+
+// Per-channel calibration: the raw readings at both ends and at rest.
+// A zeroed entry means "uncalibrated" and gets 0 / 2048 / 4095.
+typedef struct {
+    int raw_min;
+    int raw_mid;
+    int raw_max;
+} adc_cal_t;
+
+typedef struct {
+    int      bus;                           // /dev/spidev<bus>.<cs>
+    int      cs;
+    unsigned speed_hz;                      // 0 -> 250 kHz
+    int      n_channels;                    // logical channels in use
+    int      channel_map[ADC_MAX_CHANNELS]; // logical -> physical ADC input
+    adc_cal_t cal[ADC_MAX_CHANNELS];        // indexed by logical channel
+    int      sample_hz;                     // 0 = on demand, >0 = sampler thread
+} adc_config_t;
+
+// One reading of one logical channel.
+typedef struct {
+    int       raw;        // 12-bit reading, -1 if nothing sampled yet
+    int       centered;   // raw - cal.raw_mid
+    int       permille;   // -1000..1000 through the calibration
+    long long t_ns;       // CLOCK_MONOTONIC time of the transfer
+    unsigned  seq;        // bumps on every sample of this device
+} adc_sample_t;
+
+// Sampler timing for one device.
+typedef struct {
+    unsigned long long samples;     // completed rounds (all channels)
+    unsigned long long overruns;    // deadlines skipped because we were late
+    long long          max_late_ns; // worst wake-up lateness seen
+    long long          period_ns;   // 0 when read on demand
+} adc_stats_t;
+
+typedef struct adc_dev adc_dev_t;
+
+// Fills 'cfg' with the defaults for /dev/spidev<bus>.<cs>:
+// 250 kHz, channels 0 and 1, uncalibrated, on-demand reads.
+void adc_config_default(adc_config_t *cfg, int bus, int cs);
+
+// Opens and configures one ADC board. Returns NULL on failure.
+adc_dev_t *adc_open(const adc_config_t *cfg);
+void       adc_close(adc_dev_t *dev);
+
+// Reads every logical channel of 'dev' into out[0..n_channels-1].
+// Sampled devices return the latest sample; on-demand devices do one
+// chained SPI transfer for all channels. Returns 0 or -1.
+int adc_read_all(adc_dev_t *dev, adc_sample_t *out);
+
+// Logical channels of 'dev' (cfg.n_channels), or -1 if it isn't open.
+int adc_channels(adc_dev_t *dev);
+
+// Same for a single logical channel.
+int adc_read(adc_dev_t *dev, int ch, adc_sample_t *out);
+
+// Replaces the calibration of one logical channel.
+void adc_set_cal(adc_dev_t *dev, int ch, const adc_cal_t *cal);
+
+void adc_get_stats(adc_dev_t *dev, adc_stats_t *out);
+
+// Starts / stops the shared sampler thread. Devices opened with
+// sample_hz > 0 can be added or removed while it runs.
+int  adc_sampler_start(void);
+void adc_sampler_stop(void);
+bool adc_sampler_running(void);
+
+// --- Capture: the ADC as a small oscilloscope ---
+// A capture thread reads one device back-to-back as fast as the bus
+// allows: each ioctl chains as many conversions (SPI_IOC_MESSAGE(n)) as
+// spidev's buffer takes (/sys/module/spidev/parameters/bufsiz, where each
+// transfer costs a DMA-aligned slot, not its 3 bytes), cycling through
+// the device's channels. A message the driver still refuses (EMSGSIZE)
+// is rebuilt with half as many conversions. Every ioctl fills one block of a ring;
+// the thread fills one block while the reader copies out another, so
+// neither waits on the other. If the reader falls a whole ring behind,
+// new blocks are dropped (and counted) rather than stalling the bus.
+//
+// Samples inside a block are evenly spaced between t_start_ns and
+// t_end_ns. Between blocks the bus is idle for gap_ns -- the ioctl
+// turnaround, plus any normal adc_read_all() that got in between.
+// One capture at a time; the sampler and on-demand reads keep working.
+
+#define ADC_CAPTURE_MAX_XFERS  510      // per ioctl: the ioctl size field caps n
+#define ADC_CAPTURE_BLOCKS     8        // ring depth
+#define ADC_CAPTURE_SPEED_HZ   1000000  // MCP3208 at 3.3 V is good to ~1 MHz
+
+typedef struct {
+    unsigned speed_hz;     // 0 = ADC_CAPTURE_SPEED_HZ
+    int      max_xfers;    // conversions per ioctl, 0 = as many as fit
+} adc_capture_config_t;
+
+typedef struct {
+    unsigned long long seq;        // block number since the start
+    int       n_channels;
+    int       frames;              // raw[] holds frames * n_channels
+    long long t_start_ns;          // ioctl issued
+    long long t_end_ns;            // ioctl returned
+    long long gap_ns;              // bus idle since the previous block (0 = first)
+    unsigned short raw[ADC_CAPTURE_MAX_XFERS];   // frame-major, 12-bit
+} adc_capture_block_t;
+
+typedef struct {
+    unsigned long long blocks;
+    unsigned long long frames;     // one reading of every channel
+    unsigned long long dropped;    // blocks lost because the ring was full
+    unsigned long long errors;     // failed ioctls
+    int       xfers_per_ioctl;
+    int       bufsiz;              // spidev's limit in bytes
+    unsigned  speed_hz;
+    long long elapsed_ns;          // first ioctl to last
+    double    frame_hz;            // achieved, over elapsed_ns
+    double    duty;                // share of elapsed_ns spent inside ioctls
+    long long max_gap_ns;
+    long long mean_gap_ns;
+} adc_capture_stats_t;
+
+int  adc_capture_start(adc_dev_t *dev, const adc_capture_config_t *cfg);
+// Safe to call whether or not the capture is still running; closing the
+// device ends it too, and this still joins the thread.
+void adc_capture_stop(void);
+bool adc_capture_running(void);
+
+// Copies out the oldest unread block. Returns 1, 0 if none is ready yet,
+// -1 if no capture is running and nothing is left.
+int  adc_capture_read(adc_capture_block_t *out);
+
+void adc_capture_get_stats(adc_capture_stats_t *out);
+
+#endif  // HAL_ADC_H
@@ -1,6 +1,8 @@
 #ifndef HAL_JOYSTICK_H
 #define HAL_JOYSTICK_H
 
+#include "hal/adc.h"
+
 // Simple list of possible joystick directions.
 // JS_NONE = centered (no input)
 // The rest match the obvious physical directions.
@@ -13,12 +15,30 @@ typedef enum {
 } js_dir_t;
 
 // --- Setup and teardown ---
-// Opens and sets up the SPI interface for the joystick’s ADC.
+// Opens and sets up the SPI interface for the joystick’s ADC
+// (the default board on /dev/spidev0.0, X = channel 0, Y = channel 1).
 int  joystick_init(void);
 
+// Uses an already opened ADC instance instead, e.g. a second ADC board.
+// ch_x / ch_y are logical channels of that instance. The caller keeps
+// ownership of 'dev' and closes it after joystick_cleanup().
+// Returns -1 (and changes nothing) if either channel isn't one of dev's.
+int  joystick_init_dev(adc_dev_t *dev, int ch_x, int ch_y);
+
+// The ADC instance the joystick is reading (NULL before init).
+adc_dev_t *joystick_adc(void);
+
 // Closes SPI cleanly when the program ends.
 void joystick_cleanup(void);
 
+// --- Capture (scope) mode ---
+// Streams the joystick's ADC as fast as the bus goes, for looking at the
+// sensor itself (noise, drift, a bad contact). Blocks come out of
+// adc_capture_read(); joystick_active()/direction() keep working but
+// squeeze in between blocks. speed_hz 0 = ADC_CAPTURE_SPEED_HZ.
+int  joystick_capture_start(unsigned speed_hz);
+void joystick_capture_stop(void);
+
 // --- Input reading ---
 // Returns 1 if the joystick is pushed far enough in any direction
 // (i.e., not sitting in the middle deadzone).
@@ -1,6 +1,8 @@
 #ifndef HAL_LED_H
 #define HAL_LED_H
 
+#include "hal/hal_io.h"
+
 #include <stdbool.h>
 
 // Enum to pick which LED we’re working with.
@@ -10,22 +12,72 @@ typedef enum {
     LED_RED
 } led_t;
 
+#define LED_MAX        16      // most LEDs we track from /sys/class/leds
+#define LED_LEVEL_MAX  1000    // brightness levels are in permille (0..1000)
+
 // Set up both LEDs so we can control them manually.
 // (turns off system triggers like heartbeat and starts with LEDs off)
+// Also scans /sys/class/leds/* so any other LED can be used by id, and
+// keeps every brightness file open for the rest of the run.
 void led_init(void);
 
 // Turns a single LED on or off depending on 'on' being true/false.
 void led_set(led_t which, bool on);
 
+// Sets a brightness level 0..LED_LEVEL_MAX. LEDs with a real
+// max_brightness get the scaled value; on/off-only LEDs are dimmed by a
+// background software-PWM thread, so this never blocks the caller.
+void led_set_level(led_t which, int level);
+
 // Makes an LED blink a few times.
 // 'times' = how many blinks, 'half_ms' = how long it's on or off per half cycle.
 // So one full blink = on + off = 2 * half_ms total.
 void led_blink(led_t which, int times, int half_ms);
 
+// Same blink on the hal_io thread (see hal_io.h); returns at once. A blink
+// still queued for the same LED is dropped in favour of the newer one.
+// f may be NULL. Without hal_io_start() this is just led_blink().
+int  led_blink_async(led_t which, int times, int half_ms, hal_io_future_t *f);
+
 // Quickly turns both LEDs off — used when switching states or exiting.
 void led_all_off(void);
 
 // Cleans up on shutdown (turns both LEDs off and leaves board in a safe state).
 void led_cleanup(void);
 
+// --- Frames: set the state of all LEDs at once ---
+// Build a frame, then commit it: only LEDs whose level changed are
+// written, back-to-back from the cached fds, so e.g. "green off + red on"
+// reaches the hardware with no visible skew between the two.
+typedef struct {
+    int level[LED_MAX];   // indexed by LED id, 0..LED_LEVEL_MAX
+} led_frame_t;
+
+// Starts a frame from what the LEDs currently show.
+void led_frame_init(led_frame_t *f);
+
+// Starts a frame with every LED off.
+void led_frame_clear(led_frame_t *f);
+
+void led_frame_set(led_frame_t *f, led_t which, bool on);
+void led_frame_set_level(led_frame_t *f, int id, int level);
+
+// Applies the frame. With a frame rate set, waits for the next frame
+// boundary first so animations keep a steady pace regardless of how long
+// the caller spent building the frame. Returns the number of LEDs changed.
+int  led_frame_commit(const led_frame_t *f);
+
+// 0 (default) commits immediately; otherwise frames are paced at 'fps'.
+void led_frame_set_rate(int fps);
+
+// --- Generic LED access (anything found under /sys/class/leds) ---
+// Ids are 0..led_count()-1, sorted by name.
+int         led_count(void);
+int         led_find(const char *name);        // -1 if not found
+int         led_id(led_t which);               // id behind GREEN/RED, -1 if missing
+const char *led_name(int id);
+int         led_max_brightness(int id);
+void        led_set_level_id(int id, int level);
+int         led_get_level_id(int id);
+
 #endif  // HAL_LED_H
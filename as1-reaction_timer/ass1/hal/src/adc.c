@@ -0,0 +1,591 @@
+/*
+ * Multi-device SPI ADC driver (MCP3208 style, 12-bit).
+ * Every board is one instance in a small fixed table. One sampler thread
+ * walks the table and always services the device whose deadline is next,
+ * rotating the starting point so devices with the same deadline take turns.
+ * All channels of a device are read in ONE chained SPI_IOC_MESSAGE(n).
+ * Capture mode chains as many conversions per ioctl as spidev takes into a
+ * block ring.
+ */
+
+#include "hal/adc.h"
+#include "hal/timebase.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/spi/spidev.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#define ADC_SPEED_HZ   250000    // 250 kHz is plenty for slow joystick input
+#define ADC_BITS       8
+#define ADC_MODE       0
+#define ADC_IDLE_NS    (10 * NS_PER_MS) // sampler re-check interval with nothing to do
+#define ADC_XFER_BYTES 3                // one conversion on the wire
+#define SPIDEV_BUFSIZ_PATH    "/sys/module/spidev/parameters/bufsiz"
+#define SPIDEV_BUFSIZ_DEFAULT 4096
+#define SPIDEV_XFER_ALIGN     64        // ARCH_DMA_MINALIGN on AM335x: each
+                                        // transfer's bounce buffer rounds up to it
+
+struct adc_dev {
+    bool            in_use;
+    int             fd;
+    adc_config_t    cfg;
+    pthread_mutex_t lock;          // guards fd transfers + 'last'
+    adc_sample_t    last[ADC_MAX_CHANNELS];
+    unsigned        seq;
+    long long       period_ns;     // 0 = on demand
+    long long       next_ns;       // next sampler deadline
+    adc_stats_t     stats;
+};
+
+static adc_dev_t       s_devs[ADC_MAX_DEVICES];
+static pthread_mutex_t s_table_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t       s_sampler;
+static atomic_int      s_sampler_run = 0;
+static int             s_rr = 0;   // round-robin start index
+static pthread_once_t  s_once = PTHREAD_ONCE_INIT;
+
+// slot locks live as long as the process so the sampler never sees a
+// half-initialised mutex when a slot is closed and re-used
+static void init_locks(void)
+{
+    for (int i = 0; i < ADC_MAX_DEVICES; ++i)
+        pthread_mutex_init(&s_devs[i].lock, NULL);
+}
+
+// uncalibrated entries fall back to the full 12-bit range
+static adc_cal_t effective_cal(const adc_cal_t *c)
+{
+    if (c->raw_min == 0 && c->raw_mid == 0 && c->raw_max == 0) {
+        adc_cal_t def = { 0, (ADC_FULL_SCALE + 1) / 2, ADC_FULL_SCALE };
+        return def;
+    }
+    return *c;
+}
+
+static void fill_sample(const adc_dev_t *d, int ch, int raw, long long t_ns,
+                        adc_sample_t *out)
+{
+    adc_cal_t c = effective_cal(&d->cfg.cal[ch]);
+    int span = (raw >= c.raw_mid) ? (c.raw_max - c.raw_mid) : (c.raw_mid - c.raw_min);
+    int pm = (span > 0) ? ((raw - c.raw_mid) * 1000) / span : 0;
+    if (pm >  1000) pm =  1000;
+    if (pm < -1000) pm = -1000;
+
+    out->raw      = raw;
+    out->centered = raw - c.raw_mid;
+    out->permille = pm;
+    out->t_ns     = t_ns;
+    out->seq      = d->seq;
+}
+
+// One chained transfer covering every mapped channel. Caller holds d->lock.
+static int transfer_all(adc_dev_t *d)
+{
+    int n = d->cfg.n_channels;
+    unsigned char tx[ADC_MAX_CHANNELS][3];
+    unsigned char rx[ADC_MAX_CHANNELS][3];
+    struct spi_ioc_transfer tr[ADC_MAX_CHANNELS];
+    memset(tr, 0, sizeof(tr));
+    memset(rx, 0, sizeof(rx));
+
+    for (int i = 0; i < n; ++i) {
+        int ch = d->cfg.channel_map[i];
+        tx[i][0] = (unsigned char)(0x06 | ((ch & 0x04) >> 2)); // start bit + single-ended
+        tx[i][1] = (unsigned char)((ch & 0x03) << 6);          // channel select bits
+        tx[i][2] = 0x00;
+
+        tr[i].tx_buf        = (unsigned long)tx[i];
+        tr[i].rx_buf        = (unsigned long)rx[i];
+        tr[i].len           = 3;
+        tr[i].speed_hz      = d->cfg.speed_hz;
+        tr[i].bits_per_word = ADC_BITS;
+        tr[i].cs_change     = (i < n - 1);   // CS must drop between conversions
+    }
+
+    long long t = now_ns();
+    if (ioctl(d->fd, SPI_IOC_MESSAGE(n), tr) < 1) {
+        perror("SPI transfer");
+        return -1;
+    }
+
+    d->seq++;
+    for (int i = 0; i < n; ++i) {
+        int raw = ((rx[i][1] & 0x0F) << 8) | rx[i][2];
+        fill_sample(d, i, raw, t, &d->last[i]);
+    }
+    d->stats.samples++;
+    return 0;
+}
+
+void adc_config_default(adc_config_t *cfg, int bus, int cs)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->bus            = bus;
+    cfg->cs             = cs;
+    cfg->speed_hz       = ADC_SPEED_HZ;
+    cfg->n_channels     = 2;
+    cfg->channel_map[0] = 0;
+    cfg->channel_map[1] = 1;
+}
+
+adc_dev_t *adc_open(const adc_config_t *cfg)
+{
+    if (!cfg || cfg->n_channels < 1 || cfg->n_channels > ADC_MAX_CHANNELS) {
+        fprintf(stderr, "adc_open: bad channel count\n");
+        return NULL;
+    }
+    for (int i = 0; i < cfg->n_channels; ++i) {
+        if (cfg->channel_map[i] < 0 || cfg->channel_map[i] >= ADC_INPUTS) {
+            fprintf(stderr, "adc_open: channel %d maps to input %d, not 0..%d\n",
+                    i, cfg->channel_map[i], ADC_INPUTS - 1);
+            return NULL;
+        }
+    }
+
+    char path[32];
+    snprintf(path, sizeof(path), "/dev/spidev%d.%d", cfg->bus, cfg->cs);
+
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        perror("open spidev");
+        return NULL;
+    }
+
+    unsigned char mode  = ADC_MODE;
+    unsigned char bits  = ADC_BITS;
+    unsigned int  speed = cfg->speed_hz ? cfg->speed_hz : ADC_SPEED_HZ;
+
+    if (ioctl(fd, SPI_IOC_WR_MODE, &mode) ||
+        ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits) ||
+        ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed)) {
+        perror("configure spidev");
+        close(fd);
+        return NULL;
+    }
+
+    pthread_once(&s_once, init_locks);
+    pthread_mutex_lock(&s_table_lock);
+    adc_dev_t *d = NULL;
+    for (int i = 0; i < ADC_MAX_DEVICES; ++i) {
+        if (!s_devs[i].in_use) { d = &s_devs[i]; break; }
+    }
+    if (!d) {
+        pthread_mutex_unlock(&s_table_lock);
+        fprintf(stderr, "adc_open: all %d device slots in use\n", ADC_MAX_DEVICES);
+        close(fd);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&d->lock);
+    d->fd           = fd;
+    d->cfg          = *cfg;
+    d->cfg.speed_hz = speed;
+    for (int i = 0; i < ADC_MAX_CHANNELS; ++i)
+        d->last[i].raw = -1;
+    d->period_ns       = (cfg->sample_hz > 0) ? NS_PER_SEC / cfg->sample_hz : 0;
+    d->next_ns         = now_ns() + d->period_ns;
+    d->seq             = 0;
+    memset(&d->stats, 0, sizeof(d->stats));
+    d->stats.period_ns = d->period_ns;
+    d->in_use          = true;
+    pthread_mutex_unlock(&d->lock);
+    pthread_mutex_unlock(&s_table_lock);
+    return d;
+}
+
+void adc_close(adc_dev_t *dev)
+{
+    if (!dev) return;
+    pthread_mutex_lock(&s_table_lock);
+    pthread_mutex_lock(&dev->lock);
+    if (dev->in_use) {
+        dev->in_use = false;
+        close(dev->fd);
+        dev->fd = -1;
+    }
+    pthread_mutex_unlock(&dev->lock);
+    pthread_mutex_unlock(&s_table_lock);
+}
+
+int adc_read_all(adc_dev_t *dev, adc_sample_t *out)
+{
+    if (!dev || !out) return -1;
+    int rc = 0;
+    pthread_mutex_lock(&dev->lock);
+    if (!dev->in_use) {
+        rc = -1;
+    } else {
+        // sampled devices only get touched by the sampler thread, so the
+        // cached values are what the caller wants (and costs no SPI time)
+        if (dev->period_ns == 0 || !atomic_load(&s_sampler_run))
+            rc = transfer_all(dev);
+        if (rc == 0)
+            memcpy(out, dev->last, sizeof(out[0]) * (size_t)dev->cfg.n_channels);
+    }
+    pthread_mutex_unlock(&dev->lock);
+    return rc;
+}
+
+int adc_channels(adc_dev_t *dev)
+{
+    if (!dev) return -1;
+    pthread_mutex_lock(&dev->lock);
+    int n = dev->in_use ? dev->cfg.n_channels : -1;
+    pthread_mutex_unlock(&dev->lock);
+    return n;
+}
+
+int adc_read(adc_dev_t *dev, int ch, adc_sample_t *out)
+{
+    adc_sample_t all[ADC_MAX_CHANNELS];
+    if (!dev || ch < 0 || ch >= dev->cfg.n_channels) return -1;
+    if (adc_read_all(dev, all) != 0) return -1;
+    *out = all[ch];
+    return 0;
+}
+
+void adc_set_cal(adc_dev_t *dev, int ch, const adc_cal_t *cal)
+{
+    if (!dev || !cal || ch < 0 || ch >= ADC_MAX_CHANNELS) return;
+    pthread_mutex_lock(&dev->lock);
+    dev->cfg.cal[ch] = *cal;
+    pthread_mutex_unlock(&dev->lock);
+}
+
+void adc_get_stats(adc_dev_t *dev, adc_stats_t *out)
+{
+    if (!dev || !out) return;
+    pthread_mutex_lock(&dev->lock);
+    *out = dev->stats;
+    pthread_mutex_unlock(&dev->lock);
+}
+
+/* ---------- sampler thread ---------- */
+
+// Picks the sampled device with the earliest deadline and returns that
+// deadline in *due. Scanning starts at s_rr so equal deadlines are served
+// in turn. Caller holds s_table_lock; each device's schedule is read
+// under its own lock, which is what the sampler updates it under.
+static adc_dev_t *next_due(long long *due)
+{
+    adc_dev_t *best = NULL;
+    for (int k = 0; k < ADC_MAX_DEVICES; ++k) {
+        adc_dev_t *d = &s_devs[(s_rr + k) % ADC_MAX_DEVICES];
+        pthread_mutex_lock(&d->lock);
+        if (d->in_use && d->period_ns != 0 && (!best || d->next_ns < *due)) {
+            best = d;
+            *due = d->next_ns;
+        }
+        pthread_mutex_unlock(&d->lock);
+    }
+    if (best) s_rr = (int)(best - s_devs + 1) % ADC_MAX_DEVICES;
+    return best;
+}
+
+static void *sampler_thread(void *unused)
+{
+    (void)unused;
+
+    while (atomic_load(&s_sampler_run)) {
+        long long deadline = 0;
+        pthread_mutex_lock(&s_table_lock);
+        adc_dev_t *d = next_due(&deadline);
+        pthread_mutex_unlock(&s_table_lock);
+        if (!d) deadline = now_ns() + ADC_IDLE_NS;
+
+        sleep_until_ns(deadline);
+        if (!d) continue;
+
+        pthread_mutex_lock(&d->lock);
+        if (d->in_use && d->period_ns > 0 && d->next_ns == deadline) {
+            long long late = now_ns() - deadline;
+            if (late > d->stats.max_late_ns)
+                d->stats.max_late_ns = late;
+
+            (void)transfer_all(d);
+
+            // stay on the original grid; if we fell a whole period behind,
+            // skip the missed slots instead of bursting to catch up
+            d->next_ns += d->period_ns;
+            long long now = now_ns();
+            if (now >= d->next_ns) {
+                long long missed = (now - d->next_ns) / d->period_ns + 1;
+                d->stats.overruns += (unsigned long long)missed;
+                d->next_ns += missed * d->period_ns;
+            }
+        }
+        pthread_mutex_unlock(&d->lock);
+    }
+    return NULL;
+}
+
+int adc_sampler_start(void)
+{
+    if (atomic_exchange(&s_sampler_run, 1)) return 0;
+
+    // re-align every sampled device to a fresh grid starting now
+    pthread_mutex_lock(&s_table_lock);
+    long long now = now_ns();
+    for (int i = 0; i < ADC_MAX_DEVICES; ++i) {
+        pthread_mutex_lock(&s_devs[i].lock);
+        if (s_devs[i].in_use && s_devs[i].period_ns > 0)
+            s_devs[i].next_ns = now + s_devs[i].period_ns;
+        pthread_mutex_unlock(&s_devs[i].lock);
+    }
+    pthread_mutex_unlock(&s_table_lock);
+
+    if (pthread_create(&s_sampler, NULL, sampler_thread, NULL) != 0) {
+        perror("adc sampler pthread_create");
+        atomic_store(&s_sampler_run, 0);
+        return -1;
+    }
+    return 0;
+}
+
+void adc_sampler_stop(void)
+{
+    if (!atomic_exchange(&s_sampler_run, 0)) return;
+    pthread_join(s_sampler, NULL);
+}
+
+bool adc_sampler_running(void)
+{
+    return atomic_load(&s_sampler_run) != 0;
+}
+
+/* ---------- capture ---------- */
+
+static struct {
+    adc_dev_t        *dev;
+    pthread_t         thread;
+    bool              joinable;    // started and not joined yet
+    atomic_int        run;         // cleared by stop, or by the thread if the device closes
+    int               xfers;       // conversions per ioctl
+    int               frames;      // xfers / n_channels
+    unsigned          speed_hz;
+    struct spi_ioc_transfer tr[ADC_CAPTURE_MAX_XFERS];
+    unsigned char     tx[ADC_CAPTURE_MAX_XFERS][ADC_XFER_BYTES];
+    unsigned char     rx[ADC_CAPTURE_MAX_XFERS][ADC_XFER_BYTES];
+
+    // single producer (capture thread), single reader
+    adc_capture_block_t ring[ADC_CAPTURE_BLOCKS];
+    atomic_ullong     head;        // blocks published
+    atomic_ullong     tail;        // blocks consumed
+
+    pthread_mutex_t   stats_lock;
+    adc_capture_stats_t stats;
+    long long         t_first_ns;
+    long long         busy_ns;     // summed time inside ioctls
+    long long         gap_sum_ns;
+} s_cap = { .stats_lock = PTHREAD_MUTEX_INITIALIZER };
+
+// spidev refuses messages with more than bufsiz bytes in either direction,
+// counting every transfer rounded up to SPIDEV_XFER_ALIGN
+static int spidev_bufsiz(void)
+{
+    int v = 0;
+    FILE *f = fopen(SPIDEV_BUFSIZ_PATH, "r");
+    if (f) {
+        if (fscanf(f, "%d", &v) != 1)
+            v = 0;
+        fclose(f);
+    }
+    return (v > 0) ? v : SPIDEV_BUFSIZ_DEFAULT;
+}
+
+// Builds the chained message once; only rx changes between ioctls.
+static void capture_build(const adc_dev_t *d)
+{
+    memset(s_cap.tr, 0, sizeof(s_cap.tr));
+    for (int i = 0; i < s_cap.xfers; ++i) {
+        int ch = d->cfg.channel_map[i % d->cfg.n_channels];
+        s_cap.tx[i][0] = (unsigned char)(0x06 | ((ch & 0x04) >> 2));
+        s_cap.tx[i][1] = (unsigned char)((ch & 0x03) << 6);
+        s_cap.tx[i][2] = 0x00;
+
+        s_cap.tr[i].tx_buf        = (unsigned long)s_cap.tx[i];
+        s_cap.tr[i].rx_buf        = (unsigned long)s_cap.rx[i];
+        s_cap.tr[i].len           = ADC_XFER_BYTES;
+        s_cap.tr[i].speed_hz      = s_cap.speed_hz;
+        s_cap.tr[i].bits_per_word = ADC_BITS;
+        s_cap.tr[i].cs_change     = (i < s_cap.xfers - 1);
+    }
+}
+
+static void capture_account(long long t0, long long t1, long long gap, bool dropped)
+{
+    pthread_mutex_lock(&s_cap.stats_lock);
+    adc_capture_stats_t *st = &s_cap.stats;
+    if (st->blocks == 0)
+        s_cap.t_first_ns = t0;
+    st->blocks++;
+    st->frames  += (unsigned long long)s_cap.frames;
+    st->dropped += dropped;
+    s_cap.busy_ns += t1 - t0;
+    if (st->blocks > 1) {
+        s_cap.gap_sum_ns += gap;
+        if (gap > st->max_gap_ns)
+            st->max_gap_ns = gap;
+    }
+    st->elapsed_ns = t1 - s_cap.t_first_ns;
+    pthread_mutex_unlock(&s_cap.stats_lock);
+}
+
+static void *capture_thread(void *unused)
+{
+    (void)unused;
+    adc_dev_t *d = s_cap.dev;
+    int n_ch = d->cfg.n_channels;
+    long long prev_end = 0;
+
+    while (atomic_load(&s_cap.run)) {
+        // the lock is only held for one ioctl: other readers of this
+        // device get in between blocks (and show up as a longer gap)
+        pthread_mutex_lock(&d->lock);
+        if (!d->in_use) {
+            pthread_mutex_unlock(&d->lock);
+            break;
+        }
+        long long t0 = now_ns();
+        int rc = ioctl(d->fd, SPI_IOC_MESSAGE(s_cap.xfers), s_cap.tr);
+        long long t1 = now_ns();
+        pthread_mutex_unlock(&d->lock);
+
+        // the driver's real limit is below our estimate: halve and retry
+        if (rc < 1 && errno == EMSGSIZE && s_cap.xfers / 2 >= n_ch) {
+            s_cap.xfers  = (s_cap.xfers / 2) - (s_cap.xfers / 2) % n_ch;
+            s_cap.frames = s_cap.xfers / n_ch;
+            capture_build(d);
+            pthread_mutex_lock(&s_cap.stats_lock);
+            s_cap.stats.xfers_per_ioctl = s_cap.xfers;
+            pthread_mutex_unlock(&s_cap.stats_lock);
+            continue;
+        }
+        if (rc < 1) {
+            pthread_mutex_lock(&s_cap.stats_lock);
+            if (s_cap.stats.errors++ == 0)
+                perror("adc capture SPI transfer");
+            pthread_mutex_unlock(&s_cap.stats_lock);
+            sleep_ns(ADC_IDLE_NS);
+            continue;
+        }
+
+        unsigned long long h = atomic_load_explicit(&s_cap.head, memory_order_relaxed);
+        unsigned long long t = atomic_load_explicit(&s_cap.tail, memory_order_acquire);
+        bool full = (h - t) >= ADC_CAPTURE_BLOCKS;
+        long long gap = prev_end ? t0 - prev_end : 0;
+        if (!full) {
+            adc_capture_block_t *b = &s_cap.ring[h % ADC_CAPTURE_BLOCKS];
+            b->seq        = h;
+            b->n_channels = n_ch;
+            b->frames     = s_cap.frames;
+            b->t_start_ns = t0;
+            b->t_end_ns   = t1;
+            b->gap_ns     = gap;
+            for (int i = 0; i < s_cap.xfers; ++i)
+                b->raw[i] = (unsigned short)(((s_cap.rx[i][1] & 0x0F) << 8) | s_cap.rx[i][2]);
+            atomic_store_explicit(&s_cap.head, h + 1, memory_order_release);
+        }
+        capture_account(t0, t1, gap, full);
+        prev_end = t1;
+    }
+    atomic_store(&s_cap.run, 0);    // readers drain and see the end
+    return NULL;
+}
+
+int adc_capture_start(adc_dev_t *dev, const adc_capture_config_t *cfg)
+{
+    if (!dev || !dev->in_use) return -1;
+    if (atomic_load(&s_cap.run)) {
+        fprintf(stderr, "adc_capture_start: a capture is already running\n");
+        return -1;
+    }
+    adc_capture_stop();             // reap one that ended on its own
+
+    int n_ch   = dev->cfg.n_channels;
+    int bufsiz = spidev_bufsiz();
+    int xfers  = (cfg && cfg->max_xfers > 0) ? cfg->max_xfers : ADC_CAPTURE_MAX_XFERS;
+    if (xfers > ADC_CAPTURE_MAX_XFERS)
+        xfers = ADC_CAPTURE_MAX_XFERS;
+    int slot = (ADC_XFER_BYTES + SPIDEV_XFER_ALIGN - 1) / SPIDEV_XFER_ALIGN * SPIDEV_XFER_ALIGN;
+    if (xfers > bufsiz / slot)
+        xfers = bufsiz / slot;
+    xfers -= xfers % n_ch;          // whole frames only
+    if (xfers < n_ch) {
+        fprintf(stderr, "adc_capture_start: spidev bufsiz %d too small\n", bufsiz);
+        return -1;
+    }
+    unsigned speed = (cfg && cfg->speed_hz) ? cfg->speed_hz : ADC_CAPTURE_SPEED_HZ;
+
+    s_cap.dev    = dev;
+    s_cap.xfers  = xfers;
+    s_cap.frames   = xfers / n_ch;
+    s_cap.speed_hz = speed;
+    capture_build(dev);
+    atomic_store(&s_cap.head, 0);
+    atomic_store(&s_cap.tail, 0);
+
+    pthread_mutex_lock(&s_cap.stats_lock);
+    memset(&s_cap.stats, 0, sizeof(s_cap.stats));
+    s_cap.stats.xfers_per_ioctl = xfers;
+    s_cap.stats.bufsiz          = bufsiz;
+    s_cap.stats.speed_hz        = speed;
+    s_cap.busy_ns = s_cap.gap_sum_ns = 0;
+    pthread_mutex_unlock(&s_cap.stats_lock);
+
+    atomic_store(&s_cap.run, 1);
+    if (pthread_create(&s_cap.thread, NULL, capture_thread, NULL) != 0) {
+        perror("adc capture pthread_create");
+        atomic_store(&s_cap.run, 0);
+        return -1;
+    }
+    s_cap.joinable = true;
+    return 0;
+}
+
+void adc_capture_stop(void)
+{
+    atomic_store(&s_cap.run, 0);
+    if (!s_cap.joinable) return;
+    pthread_join(s_cap.thread, NULL);
+    s_cap.joinable = false;
+}
+
+bool adc_capture_running(void)
+{
+    return atomic_load(&s_cap.run) != 0;
+}
+
+int adc_capture_read(adc_capture_block_t *out)
+{
+    unsigned long long t = atomic_load_explicit(&s_cap.tail, memory_order_relaxed);
+    unsigned long long h = atomic_load_explicit(&s_cap.head, memory_order_acquire);
+    if (t == h)
+        return atomic_load(&s_cap.run) ? 0 : -1;
+
+    const adc_capture_block_t *b = &s_cap.ring[t % ADC_CAPTURE_BLOCKS];
+    size_t used = offsetof(adc_capture_block_t, raw) +
+                  sizeof(b->raw[0]) * (size_t)(b->frames * b->n_channels);
+    memcpy(out, b, used);
+    atomic_store_explicit(&s_cap.tail, t + 1, memory_order_release);
+    return 1;
+}
+
+void adc_capture_get_stats(adc_capture_stats_t *out)
+{
+    pthread_mutex_lock(&s_cap.stats_lock);
+    *out = s_cap.stats;
+    if (out->elapsed_ns > 0) {
+        out->frame_hz = (double)out->frames * 1e9 / (double)out->elapsed_ns;
+        out->duty     = (double)s_cap.busy_ns / (double)out->elapsed_ns;
+    }
+    if (out->blocks > 1)
+        out->mean_gap_ns = s_cap.gap_sum_ns / (long long)(out->blocks - 1);
+    pthread_mutex_unlock(&s_cap.stats_lock);
+}
@@ -1,129 +1,126 @@
-
  
- //* Joystick driver through SPI using a 12-bit ADC 
-// * Connected on /dev/spidev0.0.
+ //* Joystick driver on top of the multi-device ADC HAL (hal/adc.h).
+// * By default it opens its own ADC on /dev/spidev0.0.
  //* Channel 0 = X-axis, Channel 1 = Y-axis (change if wiring is different).
  
 
 #include "hal/joystick.h"
-#include <fcntl.h>
-#include <linux/spi/spidev.h>
 #include <stdio.h>
-#include <sys/ioctl.h>
-#include <unistd.h>
-
-#define SPI_DEV       "/dev/spidev0.0"
-#define SPI_SPEED_HZ  250000   // 250 kHz is plenty for slow joystick input
-#define SPI_BITS      8
-#define SPI_MODE      0
 
-#define ADC_FS        4095     // 12-bit full-scale (0-4095)
-#define ADC_MID       2048     // middle value for centered stick
 #define DEADZONE_PCT  8        // 8 % dead-zone around center
-#define DZ_TICKS      ((ADC_FS * DEADZONE_PCT) / 100 / 2) // half-width of that zone
+#define DZ_TICKS      ((ADC_FULL_SCALE * DEADZONE_PCT) / 100 / 2) // half-width of that zone
 
-static int s_fd = -1;          // file descriptor for /dev/spidev0.0
+static adc_dev_t *s_dev   = NULL;  // ADC instance the stick is wired to
+static int        s_owned = 0;     // 1 if joystick_init() opened s_dev itself
+static int        s_ch_x  = 0;     // logical ADC channels for each axis
+static int        s_ch_y  = 1;
 
-// Sends a 3-byte command and reads one 12-bit channel from the ADC.
-static int read_channel(int ch)
+// sets up the default ADC (spidev0.0, channels 0/1, read on demand)
+int joystick_init(void)
 {
-    unsigned char tx[3] = {
-        (unsigned char)(0x06 | ((ch & 0x04) >> 2)), // start bit + single-ended mode
-        (unsigned char)((ch & 0x03) << 6),          // channel select bits
-        0x00
-    };
-    unsigned char rx[3] = {0};
-
-    struct spi_ioc_transfer tr = {
-        .tx_buf = (unsigned long)tx,
-        .rx_buf = (unsigned long)rx,
-        .len = 3,
-        .speed_hz = SPI_SPEED_HZ,
-        .bits_per_word = SPI_BITS,
-        .cs_change = 0
-    };
-
-    // talk to the ADC
-    if (ioctl(s_fd, SPI_IOC_MESSAGE(1), &tr) < 1) {
-        perror("SPI transfer");
+    adc_config_t cfg;
+    adc_config_default(&cfg, 0, 0);
+
+    adc_dev_t *dev = adc_open(&cfg);
+    if (!dev)
         return -1;
-    }
 
-    // combine the two bytes into one 12-bit result
-    return ((rx[1] & 0x0F) << 8) | rx[2];
+    if (joystick_init_dev(dev, 0, 1) != 0) {
+        adc_close(dev);
+        return -1;
+    }
+    s_owned = 1;
+    return 0;
 }
 
-// sets up the SPI interface so the joystick ADC can be read
-int joystick_init(void)
+// uses an ADC instance someone else opened (e.g. a second board)
+int joystick_init_dev(adc_dev_t *dev, int ch_x, int ch_y)
 {
-    s_fd = open(SPI_DEV, O_RDWR);
-    if (s_fd < 0) {
-        perror("open spidev");
+    int n = adc_channels(dev);
+    if (n < 0 || ch_x < 0 || ch_x >= n || ch_y < 0 || ch_y >= n) {
+        fprintf(stderr, "joystick_init_dev: channels %d/%d not in 0..%d\n", ch_x, ch_y, n - 1);
         return -1;
     }
+    s_dev   = dev;
+    s_owned = 0;
+    s_ch_x  = ch_x;
+    s_ch_y  = ch_y;
+    return 0;
+}
 
-    unsigned char mode  = SPI_MODE;
-    unsigned char bits  = SPI_BITS;
-    unsigned int  speed = SPI_SPEED_HZ;
+adc_dev_t *joystick_adc(void)
+{
+    return s_dev;
+}
 
-    if (ioctl(s_fd, SPI_IOC_WR_MODE, &mode) ||
-        ioctl(s_fd, SPI_IOC_WR_BITS_PER_WORD, &bits) ||
-        ioctl(s_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed)) {
-        perror("configure spidev");
-        close(s_fd);
-        s_fd = -1;
+// scope mode: the whole bus for the stick's channels, in big chained blocks
+int joystick_capture_start(unsigned speed_hz)
+{
+    adc_capture_config_t cfg = { speed_hz, 0 };
+    if (!s_dev)
         return -1;
-    }
+    return adc_capture_start(s_dev, &cfg);
+}
 
-    return 0;
+void joystick_capture_stop(void)
+{
+    adc_capture_stop();
 }
 
-// closes SPI device when program ends
+// closes the ADC when program ends (only if we opened it)
 void joystick_cleanup(void)
 {
-    if (s_fd >= 0)
-        close(s_fd);
-    s_fd = -1;
+    joystick_capture_stop();
+    if (s_dev && s_owned)
+        adc_close(s_dev);
+    s_dev   = NULL;
+    s_owned = 0;
 }
 
-// quick wrappers so I don’t repeat channel numbers
-static int read_x(void) { return read_channel(0); }
-static int read_y(void) { return read_channel(1); }
+// reads both axes in one go; returns -1 if the ADC isn't answering
+static int read_xy(adc_sample_t *x, adc_sample_t *y)
+{
+    adc_sample_t all[ADC_MAX_CHANNELS];
+    if (!s_dev || adc_read_all(s_dev, all) != 0)
+        return -1;
+    *x = all[s_ch_x];
+    *y = all[s_ch_y];
+    if (x->raw < 0 || y->raw < 0)
+        return -1;   // sampler hasn't produced anything yet
+    return 0;
+}
 
 // checks if the stick value is inside the neutral zone
-static int in_deadzone(int val)
+static int in_deadzone(const adc_sample_t *s)
 {
-    if (val < 0 || val > ADC_FS)
+    if (s->raw < 0 || s->raw > ADC_FULL_SCALE)
         return 1;  // anything crazy = ignore it
-    int d = val - ADC_MID;
-    return (d > -DZ_TICKS && d < DZ_TICKS);
+    return (s->centered > -DZ_TICKS && s->centered < DZ_TICKS);
 }
 
 // returns 1 if joystick is clearly pressed in any direction
 int joystick_active(void)
 {
-    int x = read_x();
-    int y = read_y();
-    if (x < 0 || y < 0)
+    adc_sample_t x, y;
+    if (read_xy(&x, &y) != 0)
         return 0;
-    return !(in_deadzone(x) && in_deadzone(y));
+    return !(in_deadzone(&x) && in_deadzone(&y));
 }
 
 // figure out which way the stick is pushed
 js_dir_t joystick_direction(void)
 {
-    int x = read_x();
-    int y = read_y();
-    if (x < 0 || y < 0)
+    adc_sample_t x, y;
+    if (read_xy(&x, &y) != 0)
         return JS_NONE;
 
-    int dx = x - ADC_MID;
-    int dy = y - ADC_MID;
-
     // centered: nothing happening
-    if (in_deadzone(x) && in_deadzone(y))
+    if (in_deadzone(&x) && in_deadzone(&y))
         return JS_NONE;
 
+    int dx = x.centered;
+    int dy = y.centered;
+
     // whichever axis moved more decides the direction
     if (dx * dx > dy * dy)
         return (dx > 0) ? JS_RIGHT : JS_LEFT;
@@ -0,0 +1,79 @@
+#ifndef APP_CLASS_TABLE_H
+#define APP_CLASS_TABLE_H
+
+// What to do with each class the host can report, loaded at startup so a
+// new bin (glass, metal, ...) is a config change, not a rebuild.
+//
+// Entries are indexed by their wire id (SP_RESULT / SP_FRAME cls), so the
+// binary protocol dispatches with one array load. Names -- used by the
+// text protocol and config strings -- go through a perfect hash built at
+// load time: one probe and one strcmp, however many classes there are.
+//
+// File format, one class per line ('#' starts a comment):
+//
+//   # id  name     min_conf  targets (duty_ns:hold_ms ...)   return_ns
+//   1     paper    600       1200000:5000                    1600000
+//   2     plastic  600       2000000:5000                    1600000
+//   3     glass    700       1400000:300 1250000:4000        1600000
+//   0     reject   0         1600000:5000                    stay
+//
+// Id 0 is the reject action (no class, or below min_conf). Targets are
+// visited in order, each held for its time; return_ns is where the servo
+// goes afterwards ("stay" leaves it at the last target).
+
+#include "timebase.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CLASS_MAX          32       // wire ids 0 .. CLASS_MAX-1
+#define CLASS_MAX_TARGETS  4
+#define CLASS_NAME_LEN     16
+#define CLASS_HASH_SLOTS   128      // power of two, 4x CLASS_MAX
+#define CLASS_RETURN_STAY  (-1)
+
+typedef struct {
+    int    duty_ns;
+    nsec_t hold_ns;
+} class_target_t;
+
+typedef struct {
+    bool   used;
+    char   name[CLASS_NAME_LEN];
+    int    min_conf;                // per mille; below = reject
+    class_target_t targets[CLASS_MAX_TARGETS];
+    int    n_targets;
+    int    return_ns;               // or CLASS_RETURN_STAY
+} class_entry_t;
+
+typedef struct {
+    class_entry_t by_id[CLASS_MAX];
+    int      count;                 // used entries, reject included
+    uint32_t seed;                  // makes the name hash collision-free
+    uint8_t  slot[CLASS_HASH_SLOTS];   // name hash -> id + 1, 0 = empty
+} class_table_t;
+
+// The original two bins plus reject, from the given duties.
+void class_table_default(class_table_t *t, int neutral_ns, int paper_ns,
+                         int plastic_ns, nsec_t hold_ns, int min_conf);
+
+// Replaces *t with the file's classes. Returns 0, or -1 with a message
+// naming the line (t is left untouched).
+int  class_table_load(class_table_t *t, const char *path);
+
+static inline const class_entry_t *class_table_by_id(const class_table_t *t, int id)
+{
+    if (id < 0 || id >= CLASS_MAX || !t->by_id[id].used) return NULL;
+    return &t->by_id[id];
+}
+
+// Id for a name (len bytes, need not be NUL-terminated), or -1.
+int  class_table_find(const class_table_t *t, const char *name, size_t len);
+
+// "none" for ids without an entry.
+const char *class_table_name(const class_table_t *t, int id);
+
+// Lowest and highest duty any class uses (for the servo's clamp range).
+void class_table_span(const class_table_t *t, int *min_ns, int *max_ns);
+
+#endif
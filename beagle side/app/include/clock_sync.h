@@ -0,0 +1,45 @@
+#ifndef APP_CLOCK_SYNC_H
+#define APP_CLOCK_SYNC_H
+
+// NTP-style round-trip and offset estimate against the host.
+//
+// Each ping/pong gives four stamps: t1 (we send), t2 (host receives),
+// t3 (host sends), t4 (we receive). t1/t4 are our now_ns(), t2/t3 the
+// host's clock:
+//   rtt    = (t4 - t1) - (t3 - t2)
+//   offset = ((t2 - t1) + (t3 - t4)) / 2        (host - local)
+// Queueing only ever adds delay, so the estimate keeps the offset of the
+// lowest-RTT sample in a sliding window (NTP's clock filter).
+
+#include "timebase.h"
+
+#include <stdbool.h>
+
+#define CLOCK_SYNC_WINDOW  8
+
+typedef struct {
+    nsec_t rtt[CLOCK_SYNC_WINDOW];
+    nsec_t off[CLOCK_SYNC_WINDOW];
+    int    head, fill;
+
+    // current estimate
+    nsec_t rtt_ns;          // RTT of the chosen sample
+    nsec_t offset_ns;       // host clock - our clock
+    nsec_t rtt_last_ns;
+    nsec_t rtt_min_ns;      // best ever seen
+    nsec_t updated_ns;      // now_ns() of the last sample
+    unsigned long long samples;
+    unsigned long long rejected;   // negative RTT: reordered or bogus stamps
+} clock_sync_t;
+
+void clock_sync_init(clock_sync_t *cs);
+void clock_sync_add(clock_sync_t *cs, nsec_t t1, nsec_t t2, nsec_t t3, nsec_t t4);
+bool clock_sync_valid(const clock_sync_t *cs);
+
+// Host timestamp -> our now_ns() timeline.
+static inline nsec_t clock_sync_to_local(const clock_sync_t *cs, nsec_t host_ns)
+{
+    return host_ns - cs->offset_ns;
+}
+
+#endif
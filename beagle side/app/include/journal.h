@@ -0,0 +1,103 @@
+#ifndef APP_JOURNAL_H
+#define APP_JOURNAL_H
+
+// Persistent ring of sort events: one fixed-size record per item, in a
+// file mapped with mmap(MAP_SHARED). Appending is a few stores into the
+// mapping -- no syscalls -- and the kernel writes pages back on its own,
+// so records survive the process crashing (msync at close covers power
+// loss for a clean shutdown).
+//
+//   [ header, one 4 KiB page ][ rec 0 ][ rec 1 ] ... [ rec capacity-1 ]
+//
+// Record seq n (1-based) lives in slot (n-1) % capacity. A record is
+// committed by its seq: the slot's seq is zeroed, the fields written, and
+// the seq stored last with release ordering. A reader (or a reopen after
+// a crash) only trusts slots whose seq matches their position, so a torn
+// write reads as empty. The header's fixed fields carry a checksum; its
+// next_seq is only a hint, recovered by scanning the slots on open.
+//
+// tools/journal_read turns a journal into throughput / latency trends.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define JOURNAL_FILE      "sorter.journal"   // default; $SORTER_JOURNAL overrides
+#define JOURNAL_CAPACITY  131072             // ~9 days at 10 items/min, 10 MiB
+#define JOURNAL_MAGIC     "SORTJNL"
+#define JOURNAL_VERSION   1
+#define JOURNAL_HDR_SIZE  4096
+
+enum {
+    JOURNAL_SORTED   = 1,
+    JOURNAL_REJECTED = 2,
+};
+
+// All times are ns. t_wall is CLOCK_REALTIME (for trends across days and
+// reboots); the rest are the sorter's now_ns() stamps, so only their
+// differences mean anything.
+typedef struct {
+    uint64_t seq;               // 0 = empty or being written
+    int64_t  t_wall;            // button press, wall clock
+    int64_t  t_press;
+    int64_t  t_sent;
+    int64_t  t_result;
+    int64_t  t_actuated;
+    int64_t  t_done;
+    uint32_t job_id;
+    uint32_t boot;              // which run of the program wrote it
+    int16_t  cls;
+    uint16_t conf;              // per mille, 0 = not reported
+    int8_t   host;              // -1 = text result
+    uint8_t  outcome;           // JOURNAL_SORTED / JOURNAL_REJECTED
+    uint8_t  hedges;
+    uint8_t  frames_used;       // 0 = decided by the full result
+    uint8_t  frames_total;
+    uint8_t  pad[7];
+} journal_rec_t;
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t rec_size;
+    uint64_t capacity;
+    int64_t  created_wall;
+    uint32_t check;             // FNV-1a of the fields above
+    uint32_t boots;             // opens for writing so far
+    uint64_t next_seq;          // hint only (see above)
+} journal_hdr_t;
+
+_Static_assert(sizeof(journal_rec_t) == 80, "journal_rec_t is 80 bytes on disk");
+_Static_assert(sizeof(journal_hdr_t) <= JOURNAL_HDR_SIZE, "header fits its page");
+
+typedef struct {
+    int            fd;
+    bool           writable;
+    journal_hdr_t *hdr;
+    journal_rec_t *recs;
+    uint64_t       capacity;
+    uint64_t       next_seq;    // ours; the header copy trails it
+    uint32_t       boot;
+    size_t         map_len;
+} journal_t;
+
+// Opens or creates path (NULL = $SORTER_JOURNAL or JOURNAL_FILE) for
+// appending. An existing file with a bad header or a different capacity
+// is moved aside to <path>.bad and a new one started. Returns 0 or -1.
+int  journal_open(journal_t *j, const char *path, uint64_t capacity);
+
+// Read-only, for tools. The writer may still be appending.
+int  journal_open_ro(journal_t *j, const char *path);
+
+void journal_close(journal_t *j);
+
+// r->seq and r->boot are filled in. Never blocks, never enters the kernel.
+void journal_append(journal_t *j, const journal_rec_t *r);
+
+// Copies record seq if it is still in the ring and fully written.
+bool journal_read(const journal_t *j, uint64_t seq, journal_rec_t *out);
+
+// Oldest seq still in the ring and the next one to be written.
+void journal_range(const journal_t *j, uint64_t *first, uint64_t *next);
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef APP_SORT_PROTO_H
+#define APP_SORT_PROTO_H
+
+// Binary datagrams between the Beagle and the host (mirrored in
+// host side/ml/sort_proto.py). Little-endian, packed, fixed size per type.
+// Every message starts with sp_hdr_t; anything without the magic is
+// treated as the old plain-text protocol ("start", "paper", "plastic").
+//
+//   Beagle -> host:6000   SP_START, SP_PING
+//   host   -> Beagle:5005 SP_FRAME..., SP_RESULT, SP_PONG, SP_TIMING
+//
+// SP_FRAME streams one prediction per photo as soon as it is classified,
+// so the Beagle can act before the host's own best-of-N is finished.
+//
+// Host timestamps are the host's own monotonic clock; clock_sync.h maps
+// them onto ours.
+
+#include <stdint.h>
+
+#define SP_MAGIC    0x5354      // "TS" on the wire
+#define SP_VERSION  1
+
+enum {
+    SP_START  = 1,    // begin capture + classification for job_id
+    SP_PING   = 2,    // t1 = Beagle send time
+    SP_PONG   = 3,    // t1 echoed, t2 = host receive, t3 = host send
+    SP_TIMING = 4,    // host stage times for job_id
+    SP_RESULT = 5,    // classification for job_id
+    SP_FRAME  = 6,    // one photo's prediction for job_id
+};
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  type;
+    uint32_t job_id;
+} sp_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    sp_hdr_t h;
+    uint8_t  host_id;           // our index for that host, echoed in the result
+    uint8_t  pad[3];
+} sp_start_t;
+
+typedef struct __attribute__((packed)) {
+    sp_hdr_t h;
+    uint8_t  host_id;           // from the SP_START it answers
+    uint8_t  cls;               // sort_class_t (SORT_NONE = no idea)
+    uint16_t conf;              // confidence, per mille (0 = not reported)
+} sp_result_t;
+
+typedef struct __attribute__((packed)) {
+    sp_hdr_t h;
+    uint8_t  host_id;           // from the SP_START it answers
+    uint8_t  frame;             // 0 .. n_frames-1
+    uint8_t  n_frames;          // photos the host will classify for this job
+    uint8_t  cls;               // sort_class_t (SORT_NONE = no idea)
+    uint16_t conf;              // confidence, per mille
+    uint8_t  pad[2];
+    int64_t  t_sent;            // host clock, when this frame went out
+} sp_frame_t;
+
+typedef struct __attribute__((packed)) {
+    sp_hdr_t h;
+    int64_t  t1, t2, t3;
+} sp_ping_t;                    // SP_PING and SP_PONG
+
+typedef struct __attribute__((packed)) {
+    sp_hdr_t h;
+    int64_t  t_rx;              // SP_START received
+    int64_t  t_captured;        // photos taken
+    int64_t  t_classified;      // model done, result sent
+} sp_timing_t;
+
+_Static_assert(sizeof(sp_hdr_t) == 8, "sp_hdr_t is 8 bytes on the wire");
+_Static_assert(sizeof(sp_start_t) == 12, "sp_start_t is 12 bytes on the wire");
+_Static_assert(sizeof(sp_result_t) == 12, "sp_result_t is 12 bytes on the wire");
+_Static_assert(sizeof(sp_frame_t) == 24, "sp_frame_t is 24 bytes on the wire");
+_Static_assert(sizeof(sp_ping_t) == 32, "sp_ping_t is 32 bytes on the wire");
+_Static_assert(sizeof(sp_timing_t) == 32, "sp_timing_t is 32 bytes on the wire");
+
+static inline sp_hdr_t sp_hdr(uint8_t type, uint32_t job_id)
+{
+    sp_hdr_t h = { SP_MAGIC, SP_VERSION, type, job_id };
+    return h;
+}
+
+// Returns the header if buf holds a well-formed message, else NULL.
+static inline const sp_hdr_t *sp_parse(const void *buf, unsigned long len)
+{
+    const sp_hdr_t *h = (const sp_hdr_t *)buf;
+    if (len < sizeof(*h) || h->magic != SP_MAGIC || h->version != SP_VERSION)
+        return 0;
+    return h;
+}
+
+#endif
@@ -0,0 +1,261 @@
+#ifndef APP_SORTER_H
+#define APP_SORTER_H
+
+// The sorting state machine from main.c, separated from hardware bring-up
+// so the same code can run on the Beagle and inside tools/sorter_bench.
+//
+//   idle --button--> send "start" to host --result--> servo to the
+//   class's target(s), hold, return --> idle
+//
+// What each class does comes from a class table (class_table.h), so more
+// bins are a config file rather than a code change.
+//
+// It talks to the drivers only through rotary.h / servo.h, so the bench
+// links stub drivers in their place.
+//
+// Hedging: "start" goes to the primary host (hosts[0]). If no result has
+// come back after that host's recent p95 latency, the same job is sent
+// to the next host, and so on down the list. The first valid result for
+// the job wins; later ones only feed the per-host latency statistics.
+//
+// Streamed frames: a host may send one SP_FRAME per photo before its
+// final SP_RESULT. Each host's frames are voted as they arrive, and the
+// servo moves as soon as the outcome can no longer change (e.g. 2 of 3
+// agree), without waiting for the rest. Frames and results that arrive
+// after that are only compared against what was sorted and logged.
+//
+// Routing: a class below its confidence threshold (or no class at all)
+// is not sorted but rejected -- it gets the table's id 0 action (neutral
+// by default, so the item runs past every bin to be recirculated). An
+// item we are unsure of costs a second pass instead of a wrong bin.
+//
+// Control socket: with sorter_set_ctl(), every wait in the loop (the
+// loop period, debounce, servo holds) answers ctl.h clients instead of
+// just sleeping. Receiving and acting on a result never waits for them.
+
+#include "class_table.h"
+#include "clock_sync.h"
+#include "ctl.h"
+#include "journal.h"
+#include "servo.h"
+#include "timebase.h"
+#include "udp_rx.h"
+
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdbool.h>
+
+// Class ids as they travel on the wire (0 .. CLASS_MAX-1); 1 and 2 are
+// the original bins.
+typedef int sort_class_t;
+enum {
+    SORT_NONE    = 0,
+    SORT_PAPER   = 1,
+    SORT_PLASTIC = 2,
+};
+
+#define SORTER_MAX_HOSTS    4
+#define SORTER_LAT_WINDOW   128     // per-host latency samples kept
+#define SORTER_MAX_FRAMES   16      // frames voted per host per job
+
+typedef struct {
+    char ip[INET_ADDRSTRLEN];       // where host_main_server.py listens
+    int  port;                      // "start" goes here
+} sorter_endpoint_t;
+
+typedef struct {
+    sorter_endpoint_t hosts[SORTER_MAX_HOSTS];   // [0] is the primary
+    int    n_hosts;
+    nsec_t hedge_ns;         // fixed hedge delay (0 = primary's p95)
+    nsec_t hedge_default_ns; // used until the primary has enough samples
+    int    listen_port;      // classification results arrive here
+    int    rcvbuf_bytes;     // result socket buffer (0 = UDP_RX_RCVBUF)
+    int    neutral_ns;       // servo rest position
+    class_table_t classes;   // id -> targets, hold, return, min_conf
+    nsec_t loop_ns;          // main loop period
+    nsec_t debounce_ns;      // pause after a button press
+    nsec_t ping_ns;          // clock-sync ping period (0 = off)
+    nsec_t servo_idle_ns;    // servo output off after this long at rest (0 = never)
+    nsec_t click_start_ns;   // -1: items start on the press edge; else on a
+                             // CLICK, with this double-click window (0 = release)
+} sorter_config_t;
+
+// One host's streamed frames for the job in flight.
+typedef struct {
+    int      n_frames;          // announced by the host
+    int      seen;
+    uint32_t seen_mask;         // frame indices already counted
+    int      votes[CLASS_MAX];
+    unsigned conf[CLASS_MAX];          // summed per mille, breaks ties
+    bool     sampled;           // answer already taken as a latency sample
+} sorter_vote_t;
+
+// Timestamps (now_ns) of one item's trip through the sorter.
+typedef struct {
+    unsigned     id;
+    sort_class_t cls;
+    nsec_t       t_press;     // button seen
+    nsec_t       t_sent;      // "start" handed to the kernel (primary)
+    nsec_t       t_sent_host[SORTER_MAX_HOSTS];   // per host, 0 = not asked
+    int          hedges;      // extra hosts asked
+    int          conf;        // per mille, 0 = not reported
+    bool         rejected;    // below the class threshold, not sorted
+    int          host;        // whose result was used (-1 = text, unknown)
+    nsec_t       t_result;    // classification received
+    int64_t      t_result_host;   // host clock when the deciding frame was
+                                  // sent (0 = it was the SP_RESULT)
+    int          frames_used; // frames voted when decided (0 = SP_RESULT)
+    int          frames_total;
+    sorter_vote_t vote[SORTER_MAX_HOSTS];
+    nsec_t       t_actuated;  // servo write for the bin done
+    nsec_t       t_done;      // back at neutral, ready for the next item
+} sorter_job_t;
+
+// Where items' time went, on our timeline. Built from the host's
+// SP_TIMING report once ping/pong has an offset estimate.
+typedef struct {
+    unsigned long long count;
+    nsec_t net_out;          // start sent -> host received it
+    nsec_t capture;          // host received -> photos taken
+    nsec_t inference;        // photos taken -> result sent
+    nsec_t net_back;         // result sent -> we received it
+    nsec_t actuation;        // result received -> back at neutral
+} sorter_split_t;
+
+typedef struct {
+    unsigned long long starts;   // SP_START sent to this host
+    unsigned long long hedges;   // ... of which were hedges
+    unsigned long long wins;     // first valid result for a job
+    unsigned long long late;     // result after another host had won
+    int    samples;              // latencies in the window below
+    nsec_t p50_ns, p95_ns, p99_ns, max_ns;   // start -> result
+} sorter_host_stats_t;
+
+typedef struct {
+    unsigned long long results;  // items the routing saw with this class
+    unsigned long long sorted;   // ... sent to the class's bin
+    unsigned long long rejected; // ... below the threshold
+    unsigned long long conf_sum; // per mille, over results with a confidence
+    unsigned long long conf_n;
+} sorter_class_stats_t;
+
+typedef struct {
+    struct sockaddr_in addr;
+    clock_sync_t sync;           // RTT / offset to this host
+    sorter_host_stats_t stats;   // counters; percentiles filled on request
+    nsec_t lat[SORTER_LAT_WINDOW];
+    int    lat_head;
+} sorter_host_t;
+
+// A finished item, as kept for the control socket's latency history.
+typedef struct {
+    unsigned     id;
+    sort_class_t cls;
+    bool         rejected;
+    int          host;
+    nsec_t       item_ns;      // press -> back at neutral
+    nsec_t       host_ns;      // start sent to the winning host -> result
+} sorter_recent_t;
+
+typedef void (*sorter_job_cb)(const sorter_job_t *job, void *ctx);
+
+typedef struct {
+    sorter_config_t cfg;
+    Servo   *servo;
+    udp_rx_t rx;              // listen_port, drained in batches; also sends
+    sorter_host_t hosts[SORTER_MAX_HOSTS];   // resolved from cfg.hosts
+    nsec_t   next_ping;
+    uint32_t ping_seq;
+    nsec_t   hedge_ns;        // hedge delay for the job in flight
+    bool     waiting;         // "start" sent, result outstanding
+    sorter_job_t job;         // the item in flight
+    unsigned next_id;
+    unsigned long long sorted;
+    unsigned long long rejected;
+    sorter_class_stats_t classes[CLASS_MAX];
+    unsigned long long unknown;   // datagrams that weren't a class
+    unsigned long long stale;     // results that arrived with nothing in flight
+    unsigned long long early;     // decided before the host's last frame
+    unsigned long long late_frames;    // frames / results after the decision
+    unsigned long long late_disagree;  // ... that disagreed with the bin chosen
+    sorter_job_t last_job;        // most recent completed item
+    bool     last_split_done;     // its SP_TIMING has been accounted
+    sorter_split_t split_sum;     // totals over every accounted item
+    unsigned long long timing_unmatched;   // SP_TIMING for no known job / no sync
+    unsigned long long timing_skewed;      // ... whose legs disagree beyond rtt/2
+    sorter_job_cb on_job;
+    void    *on_job_ctx;
+    journal_t *journal;           // every finished item, if set
+    ctl_t   *ctl;                 // served while waiting, if set
+    bool     trigger;             // start requested: the knob or ctl
+    nsec_t   trigger_t;           // ... at this time (the press edge)
+    sorter_recent_t recent[SORTER_LAT_WINDOW];   // newest at recent_head - 1
+    int      recent_head;
+    int      recent_n;
+} sorter_t;
+
+// Defaults match the original main.c constants.
+void sorter_config_default(sorter_config_t *cfg);
+
+// Overrides from the environment:
+//   SORTER_HOSTS="192.168.7.1:6000,192.168.7.3:6000"   (first = primary)
+//   SORTER_HEDGE_MS=1500                               (fixed hedge delay)
+//   SORTER_CLASSES=/etc/sorter/classes.txt             (class table file)
+//   SORTER_MIN_CONF="paper:700,plastic:650" or "700"   (per mille thresholds)
+//   SORTER_SERVO_IDLE_MS=2000                          (servo off at rest, 0 = never)
+//   SORTER_CLICK_START_MS=300                          (start on a click, this
+//                                                       double-click window; unset = press)
+// Returns -1 if any of them is set but unusable.
+int  sorter_config_from_env(sorter_config_t *cfg);
+
+// Binds the result socket. The servo must already be initialised.
+int  sorter_init(sorter_t *s, const sorter_config_t *cfg, Servo *servo);
+void sorter_close(sorter_t *s);
+
+// Called after every completed item (e.g. for latency statistics).
+void sorter_on_job(sorter_t *s, sorter_job_cb cb, void *ctx);
+
+// Appends every finished item to j (opened by the caller) from now on.
+void sorter_set_journal(sorter_t *s, journal_t *j);
+
+// Serves c while waiting from now on (NULL = plain sleeps again).
+void sorter_set_ctl(sorter_t *s, ctl_t *c);
+
+// Starts an item as if the knob had been pressed (on the next step;
+// ignored while one is in flight). Returns false if busy.
+bool sorter_trigger(sorter_t *s);
+
+// An item is in flight (start sent, or the servo is still moving).
+static inline bool sorter_busy(const sorter_t *s) { return s->waiting; }
+
+// Up to n most recent items, newest first. Returns how many.
+int  sorter_recent(const sorter_t *s, sorter_recent_t *out, int n);
+
+// Zeroes the counters, latency windows and history; the clock sync and
+// the item in flight are kept.
+void sorter_reset_stats(sorter_t *s);
+
+// One loop iteration without the trailing loop sleep. Blocks for the
+// hold time when an item is actuated, like the original loop.
+void sorter_step(sorter_t *s);
+
+// Counters and start->result latency percentiles for host h.
+void sorter_get_host_stats(const sorter_t *s, int h, sorter_host_stats_t *out);
+
+// Current hedge delay (what the next job would wait before hedging).
+nsec_t sorter_hedge_delay(const sorter_t *s);
+
+// Mean split over every item with host timings (count = how many).
+void sorter_get_split(const sorter_t *s, sorter_split_t *mean);
+
+// sorter_step() + loop sleep until *keep_running goes to 0.
+void sorter_run(sorter_t *s, volatile sig_atomic_t *keep_running);
+
+// Streamed-frame voting, as sorter_step() does it per host (also used by
+// tools/sorter_check). add returns false for a frame index already seen;
+// outcome is SORT_NONE until the frames still to come can't change it.
+bool sorter_vote_add(sorter_vote_t *v, int frame, int n_frames, sort_class_t cls,
+                     unsigned conf);
+sort_class_t sorter_vote_outcome(const sorter_vote_t *v);
+
+#endif
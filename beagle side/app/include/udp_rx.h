@@ -0,0 +1,63 @@
+#ifndef APP_UDP_RX_H
+#define APP_UDP_RX_H
+
+// Batched, non-blocking UDP receive for the sorter's result port.
+//
+// udp_rx_drain() empties the socket queue with recvmmsg() into buffers
+// allocated once at open, so a burst of results never backs up behind a
+// one-datagram-per-loop reader. Each datagram comes with the kernel's
+// receive time (SO_TIMESTAMPNS, mapped onto now_ns()), and the kernel's
+// own drop counter (SO_RXQ_OVFL) is tracked so overflows are visible.
+//
+//   int n;
+//   while ((n = udp_rx_drain(&rx)) > 0)
+//       for (int i = 0; i < n; ++i) handle(rx.buf[i], rx.len[i], rx.rx_ns[i]);
+
+#include "timebase.h"
+
+#include <netinet/in.h>
+#include <stddef.h>
+
+#define UDP_RX_BATCH   16        // datagrams per recvmmsg()
+#define UDP_RX_MTU     512       // bytes kept per datagram (rest is truncated)
+#define UDP_RX_RCVBUF  (256 * 1024)
+
+typedef struct {
+    unsigned long long datagrams;
+    unsigned long long calls;          // recvmmsg() calls that returned data
+    unsigned long long max_batch;
+    unsigned long long truncated;      // longer than UDP_RX_MTU
+    unsigned long long kernel_drops;   // SO_RXQ_OVFL: dropped, queue full (the
+                                       // count rides on the next datagram queued)
+    int                rcvbuf;         // what the kernel actually granted
+} udp_rx_stats_t;
+
+typedef struct {
+    int fd;
+
+    // filled by udp_rx_drain(), valid until the next call
+    char               buf[UDP_RX_BATCH][UDP_RX_MTU + 1];   // NUL-terminated
+    size_t             len[UDP_RX_BATCH];
+    nsec_t             rx_ns[UDP_RX_BATCH];                 // kernel receive time
+    struct sockaddr_in src[UDP_RX_BATCH];
+
+    struct udp_rx_plumbing *mm;        // recvmmsg headers, allocated at open
+    udp_rx_stats_t stats;
+} udp_rx_t;
+
+// Binds INADDR_ANY:port, non-blocking, with the receive buffer asked for
+// (0 = UDP_RX_RCVBUF). Returns 0 or -1 (perror'd).
+int  udp_rx_open(udp_rx_t *rx, int port, int rcvbuf_bytes);
+void udp_rx_close(udp_rx_t *rx);
+
+// One recvmmsg(): returns datagrams received (0 = queue empty, -1 error).
+// Call until it returns less than UDP_RX_BATCH to empty the queue.
+int  udp_rx_drain(udp_rx_t *rx);
+
+void udp_rx_get_stats(const udp_rx_t *rx, udp_rx_stats_t *out);
+
+// Bytes waiting in the socket's receive queue, kernel overhead included
+// (compare with stats.rcvbuf), or -1 if the kernel won't say.
+int  udp_rx_queued(const udp_rx_t *rx);
+
+#endif
@@ -0,0 +1,214 @@
+// app/src/class_table.c
+// Class id -> servo actions, loaded from a text file at startup.
+
+#include "class_table.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLASS_MAX_SEEDS  65536
+#define CLASS_LINE_MAX   256
+#define CLASS_MAX_TOKENS (4 + CLASS_MAX_TARGETS)
+
+// FNV-1a, seeded
+static uint32_t name_hash(uint32_t seed, const char *s, size_t len)
+{
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
+    }
+    return h & (CLASS_HASH_SLOTS - 1);
+}
+
+// Looks for a seed under which no two names share a slot, so a lookup
+// never has to probe further. 32 names in 128 slots: a few dozen tries.
+static int build_hash(class_table_t *t)
+{
+    for (uint32_t seed = 0; seed < CLASS_MAX_SEEDS; ++seed) {
+        memset(t->slot, 0, sizeof(t->slot));
+        int id = 0;
+        for (; id < CLASS_MAX; ++id) {
+            const class_entry_t *e = &t->by_id[id];
+            if (!e->used) continue;
+            uint32_t s = name_hash(seed, e->name, strlen(e->name));
+            if (t->slot[s]) break;
+            t->slot[s] = (uint8_t)(id + 1);
+        }
+        if (id == CLASS_MAX) {
+            t->seed = seed;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int class_table_find(const class_table_t *t, const char *name, size_t len)
+{
+    uint8_t s = t->slot[name_hash(t->seed, name, len)];
+    if (!s) return -1;
+    const class_entry_t *e = &t->by_id[s - 1];
+    if (strlen(e->name) != len || memcmp(e->name, name, len) != 0) return -1;
+    return s - 1;
+}
+
+const char *class_table_name(const class_table_t *t, int id)
+{
+    const class_entry_t *e = class_table_by_id(t, id);
+    return e ? e->name : "none";
+}
+
+static void set_entry(class_table_t *t, int id, const char *name, int min_conf,
+                      int duty_ns, nsec_t hold_ns, int return_ns)
+{
+    class_entry_t *e = &t->by_id[id];
+    memset(e, 0, sizeof(*e));
+    e->used      = true;
+    snprintf(e->name, sizeof(e->name), "%s", name);
+    e->min_conf  = min_conf;
+    e->targets[0].duty_ns = duty_ns;
+    e->targets[0].hold_ns = hold_ns;
+    e->n_targets = 1;
+    e->return_ns = return_ns;
+    t->count++;
+}
+
+void class_table_default(class_table_t *t, int neutral_ns, int paper_ns,
+                         int plastic_ns, nsec_t hold_ns, int min_conf)
+{
+    memset(t, 0, sizeof(*t));
+    // reject: straight through at neutral, to be recirculated
+    set_entry(t, 0, "reject",  0,        neutral_ns, hold_ns, neutral_ns);
+    set_entry(t, 1, "paper",   min_conf, paper_ns,   hold_ns, neutral_ns);   // full LEFT
+    set_entry(t, 2, "plastic", min_conf, plastic_ns, hold_ns, neutral_ns);   // full RIGHT
+    build_hash(t);
+}
+
+static int parse_int(const char *tok, long lo, long hi, long *out)
+{
+    char *end;
+    errno = 0;
+    long v = strtol(tok, &end, 10);
+    if (errno || end == tok || *end || v < lo || v > hi) return -1;
+    *out = v;
+    return 0;
+}
+
+// "duty_ns:hold_ms"
+static int parse_target(const char *tok, class_target_t *out)
+{
+    char *end;
+    long duty = strtol(tok, &end, 10);
+    if (end == tok || *end != ':' || duty <= 0) return -1;
+    const char *ms = end + 1;
+    long hold = strtol(ms, &end, 10);
+    if (end == ms || *end || hold < 0) return -1;
+    out->duty_ns = (int)duty;
+    out->hold_ns = hold * NS_PER_MS;
+    return 0;
+}
+
+int class_table_load(class_table_t *t, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror("[main] class table");
+        return -1;
+    }
+
+    class_table_t n;
+    memset(&n, 0, sizeof(n));
+    char line[CLASS_LINE_MAX];
+    int lineno = 0, rc = 0;
+
+    while (rc == 0 && fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+
+        char *tok[CLASS_MAX_TOKENS + 1], *save = NULL;
+        int nt = 0;
+        for (char *p = strtok_r(line, " \t\r\n", &save); p && nt <= CLASS_MAX_TOKENS;
+             p = strtok_r(NULL, " \t\r\n", &save))
+            tok[nt++] = p;
+        if (nt == 0) continue;
+
+        // id name min_conf target... return
+        long id, conf, ret = CLASS_RETURN_STAY;
+        rc = -1;
+        if (nt < 5 || nt > CLASS_MAX_TOKENS) {
+            fprintf(stderr, "[main] %s:%d: want 'id name min_conf duty:ms... return'\n", path, lineno);
+        } else if (parse_int(tok[0], 0, CLASS_MAX - 1, &id) || n.by_id[id].used) {
+            fprintf(stderr, "[main] %s:%d: bad or repeated id '%s'\n", path, lineno, tok[0]);
+        } else if (strlen(tok[1]) >= CLASS_NAME_LEN) {
+            fprintf(stderr, "[main] %s:%d: name '%s' too long\n", path, lineno, tok[1]);
+        } else if (parse_int(tok[2], 0, 1000, &conf)) {
+            fprintf(stderr, "[main] %s:%d: min_conf is per mille, 0..1000\n", path, lineno);
+        } else if (strcmp(tok[nt - 1], "stay") != 0 && parse_int(tok[nt - 1], 1, 100000000, &ret)) {
+            fprintf(stderr, "[main] %s:%d: return must be a duty in ns or 'stay'\n", path, lineno);
+        } else {
+            rc = 0;
+        }
+        if (rc) break;
+
+        class_entry_t *e = &n.by_id[id];
+        for (int i = 3; i < nt - 1; ++i) {
+            if (parse_target(tok[i], &e->targets[e->n_targets++]) != 0) {
+                fprintf(stderr, "[main] %s:%d: bad target '%s' (duty_ns:hold_ms)\n",
+                        path, lineno, tok[i]);
+                rc = -1;
+                break;
+            }
+        }
+        for (int i = 0; rc == 0 && i < CLASS_MAX; ++i) {
+            if (n.by_id[i].used && strcmp(n.by_id[i].name, tok[1]) == 0) {
+                fprintf(stderr, "[main] %s:%d: repeated name '%s'\n", path, lineno, tok[1]);
+                rc = -1;
+            }
+        }
+        if (rc) break;
+
+        e->used      = true;
+        snprintf(e->name, sizeof(e->name), "%s", tok[1]);
+        e->min_conf  = (int)conf;
+        e->return_ns = (int)ret;
+        n.count++;
+    }
+    fclose(f);
+    if (rc) return -1;
+
+    // no reject line: keep the one we had
+    if (!n.by_id[0].used) {
+        n.by_id[0] = t->by_id[0];
+        n.count += n.by_id[0].used;
+    }
+    if (n.count < 2) {
+        fprintf(stderr, "[main] %s: no classes\n", path);
+        return -1;
+    }
+    if (build_hash(&n) != 0) {
+        fprintf(stderr, "[main] %s: no collision-free name hash\n", path);
+        return -1;
+    }
+    *t = n;
+    return 0;
+}
+
+void class_table_span(const class_table_t *t, int *min_ns, int *max_ns)
+{
+    int lo = 0, hi = 0;
+    for (int id = 0; id < CLASS_MAX; ++id) {
+        const class_entry_t *e = &t->by_id[id];
+        if (!e->used) continue;
+        for (int i = 0; i <= e->n_targets; ++i) {
+            int d = (i < e->n_targets) ? e->targets[i].duty_ns : e->return_ns;
+            if (d <= 0) continue;
+            if (!lo || d < lo) lo = d;
+            if (d > hi) hi = d;
+        }
+    }
+    *min_ns = lo;
+    *max_ns = hi;
+}
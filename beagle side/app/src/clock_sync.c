@@ -0,0 +1,44 @@
+// app/src/clock_sync.c
+// Min-RTT filter over the last few ping/pong exchanges.
+
+#include "clock_sync.h"
+
+#include <string.h>
+
+void clock_sync_init(clock_sync_t *cs)
+{
+    memset(cs, 0, sizeof(*cs));
+}
+
+void clock_sync_add(clock_sync_t *cs, nsec_t t1, nsec_t t2, nsec_t t3, nsec_t t4)
+{
+    nsec_t rtt = (t4 - t1) - (t3 - t2);
+    if (rtt < 0) {
+        cs->rejected++;
+        return;
+    }
+    nsec_t off = ((t2 - t1) + (t3 - t4)) / 2;
+
+    cs->rtt[cs->head] = rtt;
+    cs->off[cs->head] = off;
+    cs->head = (cs->head + 1) % CLOCK_SYNC_WINDOW;
+    if (cs->fill < CLOCK_SYNC_WINDOW) cs->fill++;
+
+    // the least-delayed sample has the least asymmetric queueing in it
+    int best = 0;
+    for (int i = 1; i < cs->fill; ++i) {
+        if (cs->rtt[i] < cs->rtt[best]) best = i;
+    }
+    cs->rtt_ns    = cs->rtt[best];
+    cs->offset_ns = cs->off[best];
+
+    cs->rtt_last_ns = rtt;
+    if (cs->samples == 0 || rtt < cs->rtt_min_ns) cs->rtt_min_ns = rtt;
+    cs->updated_ns = now_ns();
+    cs->samples++;
+}
+
+bool clock_sync_valid(const clock_sync_t *cs)
+{
+    return cs->fill > 0;
+}
@@ -0,0 +1,244 @@
+// app/src/journal.c
+// mmap'd ring file of sort events.
+
+#include "journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint32_t hdr_check(const journal_hdr_t *h)
+{
+    const uint8_t *p = (const uint8_t *)h;
+    uint32_t x = 2166136261u;
+    for (size_t i = 0; i < offsetof(journal_hdr_t, check); ++i) {
+        x ^= p[i];
+        x *= 16777619u;
+    }
+    return x;
+}
+
+static bool hdr_valid(const journal_hdr_t *h, uint64_t capacity)
+{
+    return memcmp(h->magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) == 0 &&
+           h->version == JOURNAL_VERSION &&
+           h->rec_size == sizeof(journal_rec_t) &&
+           (capacity == 0 || h->capacity == capacity) &&
+           h->capacity > 0 &&
+           h->check == hdr_check(h);
+}
+
+static size_t file_size(uint64_t capacity)
+{
+    return JOURNAL_HDR_SIZE + (size_t)capacity * sizeof(journal_rec_t);
+}
+
+static const char *default_path(const char *path)
+{
+    if (path) return path;
+    const char *env = getenv("SORTER_JOURNAL");
+    return (env && *env) ? env : JOURNAL_FILE;
+}
+
+static int map_file(journal_t *j, int fd, size_t len, bool writable)
+{
+    void *m = mmap(NULL, len, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                   MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) {
+        perror("[main] journal mmap");
+        return -1;
+    }
+    j->fd       = fd;
+    j->writable = writable;
+    j->map_len  = len;
+    j->hdr      = m;
+    j->recs     = (journal_rec_t *)((char *)m + JOURNAL_HDR_SIZE);
+    j->capacity = j->hdr->capacity;
+    return 0;
+}
+
+static bool slot_holds(const journal_t *j, uint64_t slot, uint64_t seq)
+{
+    return seq != 0 && (seq - 1) % j->capacity == slot;
+}
+
+// The header's next_seq may trail the records if we died between the
+// two stores; the records themselves are the truth.
+static uint64_t recover_next(const journal_t *j)
+{
+    uint64_t next = __atomic_load_n(&j->hdr->next_seq, __ATOMIC_ACQUIRE);
+    if (next == 0) next = 1;
+    for (uint64_t i = 0; i < j->capacity; ++i) {
+        uint64_t seq = __atomic_load_n(&j->recs[i].seq, __ATOMIC_ACQUIRE);
+        if (slot_holds(j, i, seq) && seq >= next) next = seq + 1;
+    }
+    return next;
+}
+
+static int create_file(const char *path, uint64_t capacity)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("[main] journal open");
+        return -1;
+    }
+    // really allocate the blocks: a store into a sparse hole on a full
+    // disk would be a SIGBUS instead of an error here
+    int rc = posix_fallocate(fd, 0, (off_t)file_size(capacity));
+    if (rc != 0) {
+        errno = rc;
+        perror("[main] journal fallocate");
+        close(fd);
+        return -1;
+    }
+
+    journal_hdr_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    h.version      = JOURNAL_VERSION;
+    h.rec_size     = sizeof(journal_rec_t);
+    h.capacity     = capacity;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    h.created_wall = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+    h.check        = hdr_check(&h);
+    h.next_seq     = 1;
+    if (pwrite(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) || fsync(fd) != 0) {
+        perror("[main] journal header");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int journal_open(journal_t *j, const char *path, uint64_t capacity)
+{
+    memset(j, 0, sizeof(*j));
+    j->fd = -1;
+    path = default_path(path);
+    if (capacity == 0) capacity = JOURNAL_CAPACITY;
+
+    int fd = open(path, O_RDWR);
+    if (fd >= 0) {
+        journal_hdr_t h;
+        struct stat st;
+        bool ok = pread(fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h) &&
+                  hdr_valid(&h, capacity) &&
+                  fstat(fd, &st) == 0 && (size_t)st.st_size >= file_size(capacity);
+        if (!ok) {
+            // keep it for a post-mortem rather than write over it
+            char bad[512];
+            snprintf(bad, sizeof(bad), "%s.bad", path);
+            fprintf(stderr, "[main] journal %s: bad header or size, moved to %s\n", path, bad);
+            close(fd);
+            if (rename(path, bad) != 0) {
+                perror("[main] journal rename");
+                return -1;
+            }
+            fd = -1;
+        }
+    } else if (errno != ENOENT) {
+        perror("[main] journal open");
+        return -1;
+    }
+    if (fd < 0 && (fd = create_file(path, capacity)) < 0) {
+        return -1;
+    }
+
+    if (map_file(j, fd, file_size(capacity), true) != 0) {
+        close(fd);
+        return -1;
+    }
+    j->next_seq = recover_next(j);
+    j->boot     = ++j->hdr->boots;
+    return 0;
+}
+
+int journal_open_ro(journal_t *j, const char *path)
+{
+    memset(j, 0, sizeof(*j));
+    j->fd = -1;
+    path = default_path(path);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    journal_hdr_t h;
+    struct stat st;
+    if (pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) || !hdr_valid(&h, 0) ||
+        fstat(fd, &st) != 0 || (size_t)st.st_size < file_size(h.capacity)) {
+        fprintf(stderr, "%s: not a journal (or a damaged one)\n", path);
+        close(fd);
+        return -1;
+    }
+    if (map_file(j, fd, file_size(h.capacity), false) != 0) {
+        close(fd);
+        return -1;
+    }
+    j->next_seq = recover_next(j);
+    j->boot     = h.boots;
+    return 0;
+}
+
+void journal_close(journal_t *j)
+{
+    if (!j->hdr) return;
+    if (j->writable && msync(j->hdr, j->map_len, MS_SYNC) != 0) {
+        perror("[main] journal msync");
+    }
+    munmap(j->hdr, j->map_len);
+    close(j->fd);
+    j->hdr  = NULL;
+    j->recs = NULL;
+    j->fd   = -1;
+}
+
+void journal_append(journal_t *j, const journal_rec_t *r)
+{
+    if (!j->hdr || !j->writable) return;
+    uint64_t seq = j->next_seq++;
+    journal_rec_t *slot = &j->recs[(seq - 1) % j->capacity];
+
+    // invalidate, fill, commit: a crash anywhere in between leaves a slot
+    // that readers skip, never a half-old half-new record
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    journal_rec_t tmp = *r;
+    tmp.boot = j->boot;
+    memcpy((char *)slot + sizeof(slot->seq), (const char *)&tmp + sizeof(tmp.seq),
+           sizeof(tmp) - sizeof(tmp.seq));
+    __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+    __atomic_store_n(&j->hdr->next_seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+bool journal_read(const journal_t *j, uint64_t seq, journal_rec_t *out)
+{
+    if (!j->hdr || seq == 0) return false;
+    const journal_rec_t *slot = &j->recs[(seq - 1) % j->capacity];
+
+    // seqlock-style: the copy only counts if seq was the same before and after
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq) return false;
+    memcpy(out, slot, sizeof(*out));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq && out->seq == seq;
+}
+
+void journal_range(const journal_t *j, uint64_t *first, uint64_t *next)
+{
+    uint64_t n = j->next_seq;
+    if (j->hdr) {
+        uint64_t hint = __atomic_load_n(&j->hdr->next_seq, __ATOMIC_ACQUIRE);
+        if (hint > n) n = hint;      // a live writer has moved on
+    }
+    *next  = n;
+    *first = (n > j->capacity) ? n - j->capacity : 1;
+}
@@ -2,45 +2,32 @@
 // Unified Beagle program:
 //
 //  - Rotary encoder button -> send "start" to host
-//  - Listen for "paper"/"plastic" -> move servo left/right, then neutral
+//  - Listen for a class -> move servo per the class table, then neutral
+//  - Local control socket ($SORTER_CTL, default /tmp/sorter.ctl) for live
+//    state and a few commands; try: socat - UNIX-CONNECT:/tmp/sorter.ctl
+//
+// The loop itself lives in sorter.c; this file brings the hardware up.
 
+#include "ctl.h"
+#include "hal_io.h"
 #include "rotary.h"
 #include "servo.h"
+#include "sorter.h"
+#include "journal.h"
+#include "timebase.h"
+#include "evlog.h"
 
-#include <arpa/inet.h>
-#include <netinet/in.h>
-#include <sys/socket.h>
-#include <fcntl.h>
-#include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <signal.h>
-#include <stdbool.h>
-#include <errno.h>
-
-// ===================== CONFIG =====================
-
-// *** CHANGE THIS to your VM/host IP ***
-#define HOST_IP "192.168.7.1"
-
-// Host listens for "start" on this port (host_main_server.py)
-#define HOST_START_PORT   6000
-
-// Beagle listens for classification result on this port
-#define BEAGLE_CLASS_PORT 5005
 
 #define SERVO_PERIOD_NS   20000000
-#define SERVO_NEUTRAL_NS  1600000 // 1600000 for neutral
-#define SERVO_MIN_NS      1200000 // 950000 is perfect clockwise for paper
-#define SERVO_MAX_NS      2000000 //2300000 is perfect ccw for platic 
-
-// servo wait time
-#define SERVO_HOLD_SECONDS 5
-
-// ==================================================
+#define CTL_PATH          "/tmp/sorter.ctl"   // $SORTER_CTL overrides, "" = off
 
 static volatile sig_atomic_t keep_running = 1;
 static Servo g_servo;   // our single servo instance
+static journal_t g_journal;
 
 static void handle_sigint(int sig)
 {
@@ -49,101 +36,151 @@ static void handle_sigint(int sig)
 }
 
 // --------------------------------------------------
-// Servo helper wrappers
+// Control socket commands (run between loop iterations, see ctl.h)
 // --------------------------------------------------
-static void servo_to_neutral(void)
+static int cmd_status(ctl_t *c, int argc, char **argv, void *ctx)
 {
-    // we just go to the neutral_ns position
-    if (servo_set_pulse_ns(&g_servo, SERVO_NEUTRAL_NS) != 0) {
-        perror("[main] servo_to_neutral");
+    (void)argc; (void)argv;
+    sorter_t *s = ctx;
+    if (sorter_busy(s)) {
+        ctl_printf(c, "in_flight 1 job %u age_ms %lld hedges %d state %s\n",
+                   s->job.id, ns_to_ms(ns_since(s->job.t_press)), s->job.hedges,
+                   s->job.t_result ? "actuating" : "waiting");
+    } else {
+        ctl_printf(c, "in_flight 0 next_job %u\n", s->next_id);
     }
+    ctl_printf(c, "sorted %llu rejected %llu early %llu unknown %llu stale %llu\n",
+               s->sorted, s->rejected, s->early, s->unknown, s->stale);
+    ctl_printf(c, "rx_queue_bytes %d rcvbuf %d kernel_drops %llu\n",
+               udp_rx_queued(&s->rx), s->rx.stats.rcvbuf, s->rx.stats.kernel_drops);
+    ctl_printf(c, "hedge_ms %lld log_dropped %llu\n",
+               ns_to_ms(sorter_hedge_delay(s)), evlog_dropped());
+    ctl_printf(c, "servo_parked %d duty_ns %d rearms %u max_rearm_us %lld\n",
+               s->servo->parked, s->servo->duty_ns, s->servo->timing.rearms,
+               ns_to_us(s->servo->timing.max_rearm_ns));
+    return 0;
 }
 
-static void servo_to_paper(void)
+static int cmd_encoder(ctl_t *c, int argc, char **argv, void *ctx)
 {
-    // full LEFT = min_ns
-    if (servo_set_pulse_ns(&g_servo, SERVO_MIN_NS) != 0) {
-        perror("[main] servo_to_paper");
-    }
+    (void)argc; (void)argv; (void)ctx;
+    rotary_stats_t rs;
+    rotaryEncoder_get_stats(&rs);
+    int vel = rotaryEncoder_get_velocity();
+    ctl_printf(c, "position %d velocity %d rpm %.1f\n", rotaryEncoder_get_position(), vel,
+               60.0 * vel / ROTARY_COUNTS_PER_REV);
+    ctl_printf(c, "steps %llu missed %llu max_late_us %lld reliable_rpm %.0f\n",
+               rs.steps, rs.missed_steps, ns_to_us(rs.max_late_ns), rs.max_reliable_rpm);
+    ctl_printf(c, "button_events %llu dropped %llu bounces %llu\n",
+               rs.events, rs.events_dropped, rs.bounces);
+    ctl_printf(c, "poll_us %lld active_us %lld active_pct %.1f cpu_pct %.2f missed_idle %llu\n",
+               ns_to_us(rs.poll_period_ns), ns_to_us(rs.active_period_ns), rs.active_pct,
+               rs.cpu_pct, rs.missed_idle);
+    return 0;
 }
 
-static void servo_to_plastic(void)
+static int cmd_latency(ctl_t *c, int argc, char **argv, void *ctx)
 {
-    // full RIGHT = max_ns
-    if (servo_set_pulse_ns(&g_servo, SERVO_MAX_NS) != 0) {
-        perror("[main] servo_to_plastic");
+    sorter_t *s = ctx;
+    int n = (argc > 1) ? atoi(argv[1]) : 10;
+    if (n <= 0 || n > SORTER_LAT_WINDOW) {
+        ctl_error(c, "N is 1..%d", SORTER_LAT_WINDOW);
+        return -1;
     }
+    sorter_recent_t r[SORTER_LAT_WINDOW];
+    n = sorter_recent(s, r, n);
+    ctl_printf(c, "%6s %-8s %4s %8s %8s\n", "job", "class", "host", "host_ms", "item_ms");
+    for (int i = 0; i < n; ++i) {
+        ctl_printf(c, "%6u %-8s %4d %8lld %8lld%s\n", r[i].id,
+                   class_table_name(&s->cfg.classes, r[i].cls), r[i].host,
+                   ns_to_ms(r[i].host_ns), ns_to_ms(r[i].item_ns),
+                   r[i].rejected ? " rejected" : "");
+    }
+    return 0;
 }
 
-// --------------------------------------------------
-// SEND "start" TO HOST
-// --------------------------------------------------
-static int send_start_to_host(void)
+static int cmd_hosts(ctl_t *c, int argc, char **argv, void *ctx)
 {
-    int sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sock < 0) {
-        perror("socket");
-        return -1;
-    }
-
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_port   = htons(HOST_START_PORT);
-
-    if (inet_pton(AF_INET, HOST_IP, &addr.sin_addr) <= 0) {
-        perror("inet_pton");
-        close(sock);
-        return -1;
+    (void)argc; (void)argv;
+    sorter_t *s = ctx;
+    for (int h = 0; h < s->cfg.n_hosts; ++h) {
+        sorter_host_stats_t hs;
+        sorter_get_host_stats(s, h, &hs);
+        ctl_printf(c, "host %d %s:%d rtt_us %lld starts %llu hedges %llu wins %llu late %llu\n",
+                   h, s->cfg.hosts[h].ip, s->cfg.hosts[h].port, ns_to_us(s->hosts[h].sync.rtt_ns),
+                   hs.starts, hs.hedges, hs.wins, hs.late);
+        ctl_printf(c, "  p50_ms %lld p95_ms %lld p99_ms %lld max_ms %lld\n",
+                   ns_to_ms(hs.p50_ns), ns_to_ms(hs.p95_ns), ns_to_ms(hs.p99_ns), ns_to_ms(hs.max_ns));
     }
+    return 0;
+}
 
-    const char *msg = "start";
-    if (sendto(sock, msg, strlen(msg), 0,
-               (struct sockaddr *)&addr, sizeof(addr)) < 0) {
-        perror("sendto");
-        close(sock);
+static int cmd_capture(ctl_t *c, int argc, char **argv, void *ctx)
+{
+    (void)argc; (void)argv;
+    if (!sorter_trigger(ctx)) {
+        ctl_error(c, "an item is in flight");
         return -1;
     }
-
-    printf("[main] Sent 'start' to %s:%d\n", HOST_IP, HOST_START_PORT);
-    close(sock);
     return 0;
 }
 
-// --------------------------------------------------
-// UDP SOCKET FOR RECEIVING "paper"/"plastic"
-// --------------------------------------------------
-static int create_result_socket(void)
+// servo <duty_ns> | neutral | <class>: the class's first target
+static int cmd_servo(ctl_t *c, int argc, char **argv, void *ctx)
 {
-    int sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sock < 0) {
-        perror("socket");
+    sorter_t *s = ctx;
+    if (argc != 2) {
+        ctl_error(c, "usage: servo <duty_ns>|neutral|<class>");
         return -1;
     }
-
-    int enable = 1;
-    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
-
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family      = AF_INET;
-    addr.sin_port        = htons(BEAGLE_CLASS_PORT);
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-
-    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
-        perror("bind");
-        close(sock);
+    if (sorter_busy(s)) {
+        ctl_error(c, "an item is in flight");
         return -1;
     }
-
-    // make non-blocking
-    int flags = fcntl(sock, F_GETFL, 0);
-    if (flags >= 0) {
-        fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+    int id = class_table_find(&s->cfg.classes, argv[1], strlen(argv[1]));
+    const class_entry_t *e = class_table_by_id(&s->cfg.classes, id);
+    int duty = !strcmp(argv[1], "neutral") ? s->cfg.neutral_ns
+             : e ? e->targets[0].duty_ns
+             : atoi(argv[1]);
+    // on the loop thread, like the sorter's own writes: the servo's state
+    // (parked, duty, timing) has one owner even with the hal_io thread on.
+    // One aligned write, <= 1 period.
+    int rc = (duty <= 0) ? -1 : servo_set_pulse_aligned(s->servo, duty);
+    if (rc != 0) {
+        ctl_error(c, "can't move to '%s'", argv[1]);
+        return -1;
     }
+    ctl_printf(c, "duty_ns %d\n", duty);
+    return 0;
+}
+
+static int cmd_reset(ctl_t *c, int argc, char **argv, void *ctx)
+{
+    (void)c; (void)argc; (void)argv;
+    sorter_reset_stats(ctx);
+    rotaryEncoder_reset_stats();
+    servo_timing_reset(&g_servo);
+    EVLOG("[main] Counters reset over the control socket.\n");
+    return 0;
+}
 
-    printf("[main] Listening for classification on UDP %d\n", BEAGLE_CLASS_PORT);
-    return sock;
+static ctl_t *open_ctl(sorter_t *s)
+{
+    const char *path = getenv("SORTER_CTL");
+    if (!path) path = CTL_PATH;
+    if (!*path) return NULL;
+
+    ctl_t *c = ctl_open(path);
+    if (!c) return NULL;
+    ctl_register(c, "status",  "in-flight item, counters, result queue", cmd_status, s);
+    ctl_register(c, "encoder", "position, velocity, poll stats", cmd_encoder, NULL);
+    ctl_register(c, "latency", "[N] last N items' host and item latency", cmd_latency, s);
+    ctl_register(c, "hosts",   "per-host RTT, hedges, latency percentiles", cmd_hosts, s);
+    ctl_register(c, "capture", "start an item as if the button was pressed", cmd_capture, s);
+    ctl_register(c, "servo",   "<duty_ns>|neutral|<class> move the servo (idle only)", cmd_servo, s);
+    ctl_register(c, "reset",   "zero counters and latency history", cmd_reset, s);
+    EVLOG("[main] Control socket on %s\n", path);
+    return c;
 }
 
 // --------------------------------------------------
@@ -152,90 +189,178 @@ int main(void)
 {
     signal(SIGINT, handle_sigint);
 
-    // Init rotary encoder
+    // every timestamp and sleep goes through timebase; check it's cheap
+    timebase_report_t tb;
+    timebase_init(&tb);
+    timebase_print(&tb, "[main]");
+
+    // Init rotary encoder. SORTER_ENC_ADAPTIVE=1: poll slowly while the
+    // knob is still instead of a fixed 1 kHz (see rotary.h)
+    const char *adaptive = getenv("SORTER_ENC_ADAPTIVE");
+    if (adaptive && atoi(adaptive) > 0) {
+        rotary_poll_cfg_t pc;
+        rotaryEncoder_poll_adaptive(&pc);
+        rotaryEncoder_set_polling(&pc);
+    }
     if (rotaryEncoder_init() != 0) {
         fprintf(stderr, "[main] ERROR: failed to init rotary encoder\n");
         return 1;
     }
 
+    sorter_config_t cfg;
+    sorter_config_default(&cfg);
+    if (sorter_config_from_env(&cfg) != 0) {
+        rotaryEncoder_cleanup();
+        return 1;
+    }
+    if (cfg.click_start_ns >= 0) {
+        rotary_gesture_cfg_t gc;
+        rotaryEncoder_gesture_defaults(&gc);
+        gc.double_click_ns = cfg.click_start_ns;
+        rotaryEncoder_set_gestures(&gc);
+    }
+
+    // the servo clamps to whatever range the class table uses
+    int min_ns, max_ns;
+    class_table_span(&cfg.classes, &min_ns, &max_ns);
+
+    // SORTER_ASYNC_IO=1: slow sysfs work runs on the hal_io thread, so the
+    // servo's export + bring-up overlaps the rest of start-up. Without it
+    // the same calls below simply run in place.
+    const char *aio = getenv("SORTER_ASYNC_IO");
+    if (aio && atoi(aio) > 0 && hal_io_start() == 0)
+        EVLOG("[main] Async HAL I/O on.\n");
+
     // Init servo: chip=-1 => use PWM0_CHIP env or default 0, channel=0
-    if (servo_init(&g_servo,
-                   -1,            // chip (override with PWM0_CHIP if needed)
-                   0,             // channel
-                   SERVO_PERIOD_NS,
-                   SERVO_NEUTRAL_NS,
-                   SERVO_MIN_NS,
-                   SERVO_MAX_NS) != 0) {
-        perror("[main] servo_init");
+    hal_io_future_t servo_up;
+    servo_init_async(&g_servo,
+                     -1,            // chip (override with PWM0_CHIP if needed)
+                     0,             // channel
+                     SERVO_PERIOD_NS,
+                     cfg.neutral_ns,
+                     min_ns,        // e.g. paper, full LEFT
+                     max_ns,        // e.g. plastic, full RIGHT
+                     &servo_up);
+
+    sorter_t sorter;
+    if (sorter_init(&sorter, &cfg, &g_servo) != 0) {
+        hal_io_stop();
+        servo_close(&g_servo);
         rotaryEncoder_cleanup();
         return 1;
     }
 
-    // Move servo to neutral at startup
-    servo_to_neutral();
-    printf("[main] Servo initialized to neutral.\n");
+    // every item also goes to a ring file that outlives the process;
+    // sorting carries on without it if it can't be opened
+    if (journal_open(&g_journal, NULL, 0) == 0) {
+        uint64_t first, next;
+        journal_range(&g_journal, &first, &next);
+        EVLOG("[main] Journal: run %u, %llu records so far\n",
+              g_journal.boot, (unsigned long long)(next - first));
+        sorter_set_journal(&sorter, &g_journal);
+    }
 
-    int sock = create_result_socket();
-    if (sock < 0) {
+    // answered from the loop's sleeps; sorting carries on without it too
+    ctl_t *ctl = open_ctl(&sorter);
+    sorter_set_ctl(&sorter, ctl);
+
+    int rc = hal_io_wait(&servo_up, 0);
+    if (rc != 0) {
+        fprintf(stderr, "[main] servo_init: %s\n", strerror(-rc));
+        ctl_close(ctl);
+        sorter_close(&sorter);
+        journal_close(&g_journal);
+        hal_io_stop();
         servo_close(&g_servo);
         rotaryEncoder_cleanup();
         return 1;
     }
+    EVLOG("[main] Servo up in %lld ms.\n", ns_to_ms(servo_up.t_done - servo_up.t_submit));
+
+    // Move servo to neutral at startup
+    servo_set_pulse_aligned(&g_servo, cfg.neutral_ns);
+    EVLOG("[main] Servo initialized to neutral.\n");
+    servo_set_idle_off(&g_servo, cfg.servo_idle_ns);
+    if (cfg.servo_idle_ns > 0)
+        EVLOG("[main] Servo output off after %lld ms at rest.\n", ns_to_ms(cfg.servo_idle_ns));
+
+    // from here on the loop only queues log records; a background thread
+    // does the formatting and the (possibly slow) console writes
+    evlog_start(stdout, false);
+
+    sorter_run(&sorter, &keep_running);
+
+    // how close did the encoder poll come to losing counts, and at what cost?
+    rotary_stats_t rs;
+    rotaryEncoder_get_stats(&rs);
+    EVLOG("[main] Encoder: %llu steps, %llu missed, worst poll late %lld us, reliable to %.0f RPM\n",
+          rs.steps, rs.missed_steps, ns_to_us(rs.max_late_ns), rs.max_reliable_rpm);
+    EVLOG("[main]   poll thread %.2f%% CPU, %.1f%% of the time at %lld us, %llu missed while slow\n",
+          rs.cpu_pct, rs.active_pct, ns_to_us(rs.active_period_ns), rs.missed_idle);
+
+    // did results queue up or overflow the socket?
+    udp_rx_stats_t rx;
+    udp_rx_get_stats(&sorter.rx, &rx);
+    EVLOG("[main] Result port: %llu datagrams in %llu batches (max %llu), %llu kernel drops\n",
+          rx.datagrams, rx.calls, rx.max_batch, rx.kernel_drops);
+
+    // where did each item's time go?
+    sorter_split_t sp;
+    sorter_get_split(&sorter, &sp);
+    for (int h = 0; h < sorter.cfg.n_hosts; ++h) {
+        const clock_sync_t *cs = &sorter.hosts[h].sync;
+        sorter_host_stats_t hs;
+        sorter_get_host_stats(&sorter, h, &hs);
+        EVLOG("[main] Host %d %s: rtt %lld us, offset %lld us\n",
+              h, sorter.cfg.hosts[h].ip, ns_to_us(cs->rtt_ns), ns_to_us(cs->offset_ns));
+        EVLOG("[main]   %llu starts (%llu hedges), %llu wins, %llu late\n",
+              hs.starts, hs.hedges, hs.wins, hs.late);
+        EVLOG("[main]   latency p50 %lld ms, p95 %lld ms, p99 %lld ms, max %lld ms\n",
+              ns_to_ms(hs.p50_ns), ns_to_ms(hs.p95_ns), ns_to_ms(hs.p99_ns), ns_to_ms(hs.max_ns));
+    }
+    if (sp.count) {
+        EVLOG("[main] Mean of %llu items: net out %lld ms, capture %lld ms, inference %lld ms, ",
+              sp.count, ns_to_ms(sp.net_out), ns_to_ms(sp.capture), ns_to_ms(sp.inference));
+        EVLOG("net back %lld ms, actuation %lld ms\n",
+              ns_to_ms(sp.net_back), ns_to_ms(sp.actuation));
+    }
+    if (sorter.timing_skewed)
+        EVLOG("[main] %llu items left out of the split: legs off by more than rtt/2\n",
+              sorter.timing_skewed);
+
+    // how often the streamed frames let us move early, and were we right?
+    EVLOG("[main] %llu items sorted, %llu rejected, %llu before the host's last frame\n",
+          sorter.sorted, sorter.rejected, sorter.early);
+    EVLOG("[main] %llu frames/results after the decision, %llu disagreed\n",
+          sorter.late_frames, sorter.late_disagree);
+
+    // per class: how often was the model unsure?
+    for (int c = 0; c < CLASS_MAX; ++c) {
+        const sorter_class_stats_t *cs = &sorter.classes[c];
+        if (!cs->results) continue;
+        EVLOG("[main]   %-8s %llu results, %llu rejected, mean confidence %llu per mille\n",
+              class_table_name(&sorter.cfg.classes, c), cs->results, cs->rejected,
+              cs->conf_n ? cs->conf_sum / cs->conf_n : 0ULL);
+    }
+
+    // were duty writes late or bunched? (gate stutter)
+    servo_timing_report(&g_servo);
+    if (hal_io_running()) {
+        hal_io_stats_t io;
+        hal_io_get_stats(&io);
+        EVLOG("[main] Async I/O: %llu commands, %llu superseded, %llu refused (queue full)\n",
+              io.submitted, io.superseded, io.queue_full);
+        EVLOG("[main]   worst wait %lld us, worst run %lld us\n",
+              ns_to_us(io.max_wait_ns), ns_to_us(io.max_exec_ns));
+    }
 
-    bool waiting_for_result = false;
-    printf("[main] Ready. Press encoder button to start.\n");
-
-    while (keep_running) {
-        // 1) Rotary button press -> send "start"
-        if (!waiting_for_result && rotaryEncoder_button_pressed()) {
-            printf("[main] Button press detected. Sending 'start' to host.\n");
-            if (send_start_to_host() == 0) {
-                waiting_for_result = true;
-                printf("[main] Waiting for ML result from host...\n");
-            }
-            usleep(200 * 1000); // 200 ms debounce
-        }
-
-        // 2) If waiting, check for classification result
-        if (waiting_for_result) {
-            char buf[64];
-            struct sockaddr_in src;
-            socklen_t slen = sizeof(src);
-
-            ssize_t n = recvfrom(sock, buf, sizeof(buf) - 1, 0,
-                                 (struct sockaddr *)&src, &slen);
-            if (n > 0) {
-                buf[n] = '\0';
-                printf("[main] Received: '%s'\n", buf);
-
-                if (strcmp(buf, "paper") == 0) {
-                    printf("[main] PAPER → move servo LEFT\n");
-                    servo_to_paper();
-                    sleep(SERVO_HOLD_SECONDS);
-                    servo_to_neutral();
-                    printf("[main] Servo back to neutral.\n");
-                    waiting_for_result = false;
-                }
-                else if (strcmp(buf, "plastic") == 0) {
-                    printf("[main] PLASTIC → move servo RIGHT\n");
-                    servo_to_plastic();
-                    sleep(SERVO_HOLD_SECONDS);
-                    servo_to_neutral();
-                    printf("[main] Servo back to neutral.\n");
-                    waiting_for_result = false;
-                }
-                else {
-                    printf("[main] Unknown classification message, ignoring.\n");
-                }
-            }
-        }
-
-        usleep(5 * 1000); // 5 ms loop
-    }
-
-    close(sock);
+    ctl_close(ctl);
+    sorter_close(&sorter);
+    journal_close(&g_journal);
+    hal_io_stop();
     servo_close(&g_servo);
     rotaryEncoder_cleanup();
-    printf("[main] Exiting.\n");
+    EVLOG("[main] Exiting.\n");
+    evlog_stop();
     return 0;
 }
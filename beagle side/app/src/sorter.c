@@ -0,0 +1,787 @@
+// app/src/sorter.c
+// Sorting loop: button -> "start" to host -> result -> servo -> neutral.
+// Hardware bring-up stays in main.c; this file only uses the driver APIs.
+
+#include "sorter.h"
+#include "sort_proto.h"
+#include "rotary.h"
+#include "evlog.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+// ===================== DEFAULTS =====================
+
+// *** CHANGE THIS to your VM/host IP ***
+#define HOST_IP "192.168.7.1"
+
+// Host listens for "start" on this port (host_main_server.py)
+#define HOST_START_PORT   6000
+
+// Beagle listens for classification result on this port
+#define BEAGLE_CLASS_PORT 5005
+
+#define SERVO_NEUTRAL_NS  1600000 // 1600000 for neutral
+#define SERVO_MIN_NS      1200000 // 950000 is perfect clockwise for paper
+#define SERVO_MAX_NS      2000000 //2300000 is perfect ccw for platic 
+
+// servo wait time
+#define SERVO_HOLD_SECONDS 5
+#define SERVO_IDLE_MS      2000   // at rest this long -> output off (servo_idle)
+
+// below this confidence (per mille) an item is rejected, not sorted;
+// the model is a two-way softmax, so 500 is a coin toss
+#define MIN_CONF_DEFAULT  600
+
+// ====================================================
+
+// hedge on the primary's own p95 once it has this many samples
+#define HEDGE_MIN_SAMPLES  16
+#define HEDGE_FLOOR_NS     (100 * NS_PER_MS)
+
+void sorter_config_default(sorter_config_t *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    snprintf(cfg->hosts[0].ip, sizeof(cfg->hosts[0].ip), "%s", HOST_IP);
+    cfg->hosts[0].port = HOST_START_PORT;
+    cfg->n_hosts     = 1;
+    cfg->hedge_default_ns = 2 * NS_PER_SEC;
+    cfg->listen_port = BEAGLE_CLASS_PORT;
+    cfg->neutral_ns  = SERVO_NEUTRAL_NS;
+    class_table_default(&cfg->classes, SERVO_NEUTRAL_NS, SERVO_MIN_NS, SERVO_MAX_NS,
+                        SERVO_HOLD_SECONDS * NS_PER_SEC, MIN_CONF_DEFAULT);
+    cfg->loop_ns     = 5 * NS_PER_MS;
+    cfg->debounce_ns = 200 * NS_PER_MS;
+    cfg->ping_ns     = 1 * NS_PER_SEC;
+    cfg->servo_idle_ns = SERVO_IDLE_MS * NS_PER_MS;
+    cfg->click_start_ns = -1;
+}
+
+// "paper:700,plastic:650", or one number for every class
+static int parse_min_conf(sorter_config_t *cfg, const char *list)
+{
+    const char *p = list;
+    while (*p) {
+        size_t len = strcspn(p, ",");
+        char item[32];
+        snprintf(item, sizeof(item), "%.*s", (int)len, p);
+        p += len + (p[len] == ',');
+
+        char *colon = strchr(item, ':');
+        int v = atoi(colon ? colon + 1 : item);
+        if (v < 0 || v > 1000) {
+            fprintf(stderr, "[main] SORTER_MIN_CONF: bad value in '%s'\n", item);
+            return -1;
+        }
+        if (!colon) {
+            for (int c = SORT_NONE + 1; c < CLASS_MAX; ++c) cfg->classes.by_id[c].min_conf = v;
+            continue;
+        }
+        int c = class_table_find(&cfg->classes, item, (size_t)(colon - item));
+        if (c <= SORT_NONE) {
+            fprintf(stderr, "[main] SORTER_MIN_CONF: unknown class in '%s'\n", item);
+            return -1;
+        }
+        cfg->classes.by_id[c].min_conf = v;
+    }
+    return 0;
+}
+
+int sorter_config_from_env(sorter_config_t *cfg)
+{
+    const char *hedge = getenv("SORTER_HEDGE_MS");
+    if (hedge && *hedge) {
+        cfg->hedge_ns = atoll(hedge) * NS_PER_MS;
+    }
+
+    const char *idle = getenv("SORTER_SERVO_IDLE_MS");
+    if (idle && *idle) {
+        cfg->servo_idle_ns = atoll(idle) * NS_PER_MS;
+    }
+
+    const char *click = getenv("SORTER_CLICK_START_MS");
+    if (click && *click) {
+        cfg->click_start_ns = atoll(click) * NS_PER_MS;
+        if (cfg->click_start_ns < 0) {
+            fprintf(stderr, "[main] SORTER_CLICK_START_MS: bad value '%s'\n", click);
+            return -1;
+        }
+    }
+
+    // the table first: thresholds name its classes
+    const char *classes = getenv("SORTER_CLASSES");
+    if (classes && *classes && class_table_load(&cfg->classes, classes) != 0) {
+        return -1;
+    }
+
+    const char *conf = getenv("SORTER_MIN_CONF");
+    if (conf && *conf && parse_min_conf(cfg, conf) != 0) {
+        return -1;
+    }
+
+    const char *list = getenv("SORTER_HOSTS");
+    if (!list || !*list) {
+        return 0;
+    }
+
+    // "ip:port,ip:port,..." (port defaults to HOST_START_PORT)
+    int n = 0;
+    const char *p = list;
+    while (*p && n < SORTER_MAX_HOSTS) {
+        size_t len = strcspn(p, ",");
+        char item[64];
+        snprintf(item, sizeof(item), "%.*s", (int)len, p);
+        p += len + (p[len] == ',');
+
+        sorter_endpoint_t *e = &cfg->hosts[n];
+        char *colon = strchr(item, ':');
+        e->port = colon ? atoi(colon + 1) : HOST_START_PORT;
+        if (colon) *colon = '\0';
+        struct in_addr tmp;
+        if (inet_pton(AF_INET, item, &tmp) != 1 || e->port <= 0 || e->port > 65535) {
+            fprintf(stderr, "[main] SORTER_HOSTS: bad entry '%s'\n", item);
+            return -1;
+        }
+        inet_ntop(AF_INET, &tmp, e->ip, sizeof(e->ip));   // canonical, always fits
+        n++;
+    }
+    if (n == 0) {
+        return -1;
+    }
+    cfg->n_hosts = n;
+    return 0;
+}
+
+// --------------------------------------------------
+// Servo helper
+// --------------------------------------------------
+static void servo_to(sorter_t *s, int duty_ns, const char *what)
+{
+    int rc = servo_set_pulse_aligned(s->servo, duty_ns);
+    if (rc != 0) {
+        EVLOG("[main] servo_to_%s: %s\n", what, strerror(-rc));
+    }
+}
+
+// --------------------------------------------------
+// SEND TO HOST
+// --------------------------------------------------
+// Everything goes out of the result socket, so a host can answer the
+// source address and replies come back on the port we already drain.
+static int send_to_host(sorter_t *s, int h, const void *msg, size_t len)
+{
+    const struct sockaddr_in *to = &s->hosts[h].addr;
+    if (sendto(s->rx.fd, msg, len, 0, (const struct sockaddr *)to, sizeof(*to)) < 0) {
+        EVLOG("[main] sendto host %d: %s\n", h, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int send_start_to_host(sorter_t *s, int h)
+{
+    sp_start_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.h       = sp_hdr(SP_START, s->job.id);
+    msg.host_id = (uint8_t)h;
+    if (send_to_host(s, h, &msg, sizeof(msg)) != 0) {
+        return -1;
+    }
+    s->job.t_sent_host[h] = now_ns();
+    s->hosts[h].stats.starts++;
+    EVLOG("[main] Sent 'start' (job %u) to %s:%d\n", s->job.id,
+          s->cfg.hosts[h].ip, s->cfg.hosts[h].port);
+    return 0;
+}
+
+// one host per ping period, round robin
+static void send_ping(sorter_t *s)
+{
+    sp_ping_t msg;
+    memset(&msg, 0, sizeof(msg));
+    int h  = (int)(s->ping_seq % (uint32_t)s->cfg.n_hosts);
+    msg.h  = sp_hdr(SP_PING, s->ping_seq++);
+    msg.t1 = now_ns();
+    send_to_host(s, h, &msg, sizeof(msg));
+}
+
+static int host_by_addr(const sorter_t *s, const struct sockaddr_in *a)
+{
+    for (int h = 0; h < s->cfg.n_hosts; ++h) {
+        const struct sockaddr_in *e = &s->hosts[h].addr;
+        if (e->sin_addr.s_addr == a->sin_addr.s_addr && e->sin_port == a->sin_port)
+            return h;
+    }
+    return -1;
+}
+
+// --------------------------------------------------
+// Per-host latency and hedging
+// --------------------------------------------------
+static void host_add_latency(sorter_host_t *h, nsec_t lat)
+{
+    h->lat[h->lat_head] = lat;
+    h->lat_head = (h->lat_head + 1) % SORTER_LAT_WINDOW;
+    if (h->stats.samples < SORTER_LAT_WINDOW) h->stats.samples++;
+}
+
+static int cmp_nsec(const void *a, const void *b)
+{
+    nsec_t x = *(const nsec_t *)a, y = *(const nsec_t *)b;
+    return (x > y) - (x < y);
+}
+
+void sorter_get_host_stats(const sorter_t *s, int h, sorter_host_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (h < 0 || h >= s->cfg.n_hosts) return;
+    const sorter_host_t *host = &s->hosts[h];
+    *out = host->stats;
+
+    int n = host->stats.samples;
+    if (n == 0) return;
+    nsec_t v[SORTER_LAT_WINDOW];
+    memcpy(v, host->lat, sizeof(v[0]) * (size_t)n);   // window fills from 0
+    qsort(v, (size_t)n, sizeof(v[0]), cmp_nsec);
+    out->p50_ns = v[n / 2];
+    out->p95_ns = v[(n * 95) / 100];
+    out->p99_ns = v[(n * 99) / 100];
+    out->max_ns = v[n - 1];
+}
+
+nsec_t sorter_hedge_delay(const sorter_t *s)
+{
+    if (s->cfg.hedge_ns > 0) return s->cfg.hedge_ns;
+
+    sorter_host_stats_t st;
+    sorter_get_host_stats(s, 0, &st);
+    if (st.samples < HEDGE_MIN_SAMPLES) return s->cfg.hedge_default_ns;
+    return st.p95_ns > HEDGE_FLOOR_NS ? st.p95_ns : HEDGE_FLOOR_NS;
+}
+
+// no result after the hedge delay: ask the next host as well
+static void maybe_hedge(sorter_t *s)
+{
+    int next = 1 + s->job.hedges;
+    if (next >= s->cfg.n_hosts) return;
+
+    nsec_t last = s->job.t_sent_host[next - 1] ? s->job.t_sent_host[next - 1] : s->job.t_sent;
+    if (now_ns() - last < s->hedge_ns) return;
+
+    s->job.hedges++;
+    if (send_start_to_host(s, next) == 0) {
+        s->hosts[next].stats.hedges++;
+        EVLOG("[main] No result after %lld ms, hedged job %u to host %d\n",
+              ns_to_ms(s->hedge_ns), s->job.id, next);
+    }
+}
+
+// --------------------------------------------------
+
+int sorter_init(sorter_t *s, const sorter_config_t *cfg, Servo *servo)
+{
+    memset(s, 0, sizeof(*s));
+    s->cfg   = *cfg;
+    s->servo = servo;
+    if (s->cfg.n_hosts < 1) s->cfg.n_hosts = 1;
+    if (s->cfg.n_hosts > SORTER_MAX_HOSTS) s->cfg.n_hosts = SORTER_MAX_HOSTS;
+
+    for (int h = 0; h < s->cfg.n_hosts; ++h) {
+        sorter_host_t *host = &s->hosts[h];
+        clock_sync_init(&host->sync);
+        host->addr.sin_family = AF_INET;
+        host->addr.sin_port   = htons(s->cfg.hosts[h].port);
+        if (inet_pton(AF_INET, s->cfg.hosts[h].ip, &host->addr.sin_addr) <= 0) {
+            fprintf(stderr, "[main] bad host address '%s'\n", s->cfg.hosts[h].ip);
+            return -1;
+        }
+    }
+
+    for (int id = 0; id < CLASS_MAX; ++id) {
+        const class_entry_t *e = class_table_by_id(&s->cfg.classes, id);
+        if (e) EVLOG("[main] Class %d %s: %d target(s), min confidence %d per mille\n",
+                     id, e->name, e->n_targets, e->min_conf);
+    }
+
+    if (udp_rx_open(&s->rx, cfg->listen_port, cfg->rcvbuf_bytes) != 0)
+        return -1;
+    EVLOG("[main] Listening for classification on UDP %d (rcvbuf %d), %d host(s)\n",
+          cfg->listen_port, s->rx.stats.rcvbuf, s->cfg.n_hosts);
+    return 0;
+}
+
+void sorter_close(sorter_t *s)
+{
+    udp_rx_close(&s->rx);
+}
+
+void sorter_on_job(sorter_t *s, sorter_job_cb cb, void *ctx)
+{
+    s->on_job     = cb;
+    s->on_job_ctx = ctx;
+}
+
+void sorter_set_journal(sorter_t *s, journal_t *j)
+{
+    s->journal = j;
+}
+
+void sorter_set_ctl(sorter_t *s, ctl_t *c)
+{
+    s->ctl = c;
+}
+
+bool sorter_trigger(sorter_t *s)
+{
+    if (s->waiting) return false;
+    s->trigger   = true;
+    s->trigger_t = now_ns();
+    return true;
+}
+
+// every wait in the loop: a plain sleep, or one that answers ctl clients
+static void sorter_sleep(sorter_t *s, nsec_t ns)
+{
+    ctl_wait_until(s->ctl, now_ns() + ns);
+}
+
+static void remember_job(sorter_t *s)
+{
+    const sorter_job_t *job = &s->job;
+    sorter_recent_t *r = &s->recent[s->recent_head];
+    nsec_t sent = (job->host >= 0 && job->t_sent_host[job->host]) ? job->t_sent_host[job->host]
+                                                                  : job->t_sent;
+    r->id       = job->id;
+    r->cls      = job->cls;
+    r->rejected = job->rejected;
+    r->host     = job->host;
+    r->item_ns  = job->t_done - job->t_press;
+    r->host_ns  = job->t_result - sent;
+    s->recent_head = (s->recent_head + 1) % SORTER_LAT_WINDOW;
+    if (s->recent_n < SORTER_LAT_WINDOW) s->recent_n++;
+}
+
+int sorter_recent(const sorter_t *s, sorter_recent_t *out, int n)
+{
+    if (n > s->recent_n) n = s->recent_n;
+    for (int i = 0; i < n; ++i)
+        out[i] = s->recent[(s->recent_head - 1 - i + SORTER_LAT_WINDOW) % SORTER_LAT_WINDOW];
+    return n;
+}
+
+void sorter_reset_stats(sorter_t *s)
+{
+    s->sorted = s->rejected = 0;
+    s->unknown = s->stale = s->early = 0;
+    s->late_frames = s->late_disagree = 0;
+    s->timing_unmatched = 0;
+    s->timing_skewed = 0;
+    memset(s->classes, 0, sizeof(s->classes));
+    memset(&s->split_sum, 0, sizeof(s->split_sum));
+    for (int h = 0; h < SORTER_MAX_HOSTS; ++h) {
+        memset(&s->hosts[h].stats, 0, sizeof(s->hosts[h].stats));
+        s->hosts[h].lat_head = 0;
+    }
+    s->recent_head = s->recent_n = 0;
+
+    // the kernel's drop count is a running total; it can't be reset
+    udp_rx_stats_t keep = s->rx.stats;
+    memset(&s->rx.stats, 0, sizeof(s->rx.stats));
+    s->rx.stats.rcvbuf       = keep.rcvbuf;
+    s->rx.stats.kernel_drops = keep.kernel_drops;
+}
+
+// the finished job, as a fixed-size record in the mmap'd ring
+static void journal_job(sorter_t *s)
+{
+    const sorter_job_t *job = &s->job;
+    journal_rec_t r;
+    memset(&r, 0, sizeof(r));
+
+    r.t_wall       = wall_ns() - (now_ns() - job->t_press);   // when pressed
+    r.t_press      = job->t_press;
+    r.t_sent       = job->t_sent;
+    r.t_result     = job->t_result;
+    r.t_actuated   = job->t_actuated;
+    r.t_done       = job->t_done;
+    r.job_id       = job->id;
+    r.cls          = (int16_t)job->cls;
+    r.conf         = (uint16_t)job->conf;
+    r.host         = (int8_t)job->host;
+    r.outcome      = job->rejected ? JOURNAL_REJECTED : JOURNAL_SORTED;
+    r.hedges       = (uint8_t)job->hedges;
+    r.frames_used  = (uint8_t)job->frames_used;
+    r.frames_total = (uint8_t)job->frames_total;
+    journal_append(s->journal, &r);
+}
+
+// Walk the class's targets (or the reject action's), then return.
+// Table lookups are by id: the same cost for 2 classes or 30.
+static void actuate(sorter_t *s, sort_class_t cls, int conf)
+{
+    const class_table_t *t = &s->cfg.classes;
+    const class_entry_t *e = class_table_by_id(t, cls);
+    sorter_class_stats_t *cs = &s->classes[e ? cls : SORT_NONE];
+
+    s->job.cls  = cls;
+    s->job.conf = conf;
+    s->job.rejected = !e || cls == SORT_NONE || (conf > 0 && conf < e->min_conf);
+    cs->results++;
+    if (conf > 0) {
+        cs->conf_sum += (unsigned)conf;
+        cs->conf_n++;
+    }
+
+    if (s->job.rejected) {
+        EVLOG("[main] %s at %d.%d%% -> REJECT\n", class_table_name(t, cls), conf / 10, conf % 10);
+        e = class_table_by_id(t, SORT_NONE);
+        cs->rejected++;
+        s->rejected++;
+    }
+
+    for (int i = 0; e && i < e->n_targets; ++i) {
+        const class_target_t *tg = &e->targets[i];
+        EVLOG("[main] %s -> servo %d ns for %lld ms\n", e->name, tg->duty_ns, ns_to_ms(tg->hold_ns));
+        servo_to(s, tg->duty_ns, e->name);
+        if (i == 0) s->job.t_actuated = now_ns();
+        sorter_sleep(s, tg->hold_ns);
+    }
+    if (e && e->return_ns != CLASS_RETURN_STAY) {
+        servo_to(s, e->return_ns, "return");
+        EVLOG("[main] Servo returned.\n");
+    }
+
+    s->job.t_done = now_ns();
+    s->waiting = false;
+    if (!s->job.rejected) {
+        cs->sorted++;
+        s->sorted++;
+    }
+    if (s->journal) journal_job(s);
+    remember_job(s);
+    s->last_job = s->job;
+    s->last_split_done = false;
+    if (s->on_job) s->on_job(&s->job, s->on_job_ctx);
+}
+
+// host stage times for a finished item -> network / compute / actuation
+static void handle_timing(sorter_t *s, int h, const sp_timing_t *t)
+{
+    const sorter_job_t *j = &s->last_job;
+    if (s->last_split_done || h < 0 || h != j->host || t->h.job_id != j->id ||
+        !j->t_done || !clock_sync_valid(&s->hosts[h].sync)) {
+        s->timing_unmatched++;
+        return;
+    }
+
+    const clock_sync_t *cs = &s->hosts[h].sync;
+    nsec_t sent = j->t_sent_host[h];
+    nsec_t rx   = clock_sync_to_local(cs, t->t_rx);
+    nsec_t cap  = clock_sync_to_local(cs, t->t_captured);
+    // decided on a streamed frame: "inference" ends there, not at the
+    // host's full vote
+    nsec_t done = clock_sync_to_local(cs, j->t_result_host ? j->t_result_host
+                                                            : t->t_classified);
+
+    // The offset is only good to rtt/2, and its error moves time from one
+    // network leg to the other. A leg below zero is that error: hand it
+    // back to the other leg. Beyond rtt/2 the stamps don't add up.
+    nsec_t out  = rx - sent;
+    nsec_t back = j->t_result - done;
+    nsec_t slack = cs->rtt_ns / 2;
+    if (out < -slack || back < -slack || out + back < 0) {
+        s->timing_skewed++;
+        s->last_split_done = true;
+        EVLOG("[main] job %u: timing off by more than rtt/2 (net out %lld us, back %lld us), "
+              "not counted\n", j->id, ns_to_us(out), ns_to_us(back));
+        return;
+    }
+    if (out < 0)  { back += out; out = 0; }
+    if (back < 0) { out += back; back = 0; }
+
+    sorter_split_t *sum = &s->split_sum;
+    sum->count++;
+    sum->net_out   += out;
+    sum->capture   += cap - rx;
+    sum->inference += done - cap;
+    sum->net_back  += back;
+    sum->actuation += j->t_done - j->t_result;
+    s->last_split_done = true;
+
+    EVLOG("[main] job %u: net out %lld ms, capture %lld ms, inference %lld ms, ",
+          j->id, ns_to_ms(out), ns_to_ms(cap - rx), ns_to_ms(done - cap));
+    EVLOG("net back %lld ms, actuation %lld ms\n",
+          ns_to_ms(back), ns_to_ms(j->t_done - j->t_result));
+}
+
+// A classification from host h (-1 = unknown, e.g. the text protocol).
+// Text results carry no job id and count for whatever is in flight.
+static void handle_class(sorter_t *s, sort_class_t cls, int conf, int h, bool has_id,
+                         uint32_t job_id, nsec_t rx_ns)
+{
+    bool current = s->waiting && (!has_id || job_id == s->job.id);
+    bool previous = !current && has_id && s->last_job.t_done && job_id == s->last_job.id;
+
+    // every answer is a latency sample for its host, winner or not
+    // (once: a host whose frames decided also sends its full result)
+    if (h >= 0) {
+        sorter_job_t *j = current ? &s->job : previous ? &s->last_job : NULL;
+        if (j && j->t_sent_host[h] && !j->vote[h].sampled) {
+            host_add_latency(&s->hosts[h], rx_ns - j->t_sent_host[h]);
+            j->vote[h].sampled = true;
+        }
+    }
+
+    if (!current) {
+        if (previous && h >= 0 && h == s->last_job.host) {
+            // the winner's full vote, after we went on its frames
+            s->late_frames++;
+            if (cls != s->last_job.cls) s->late_disagree++;
+            EVLOG("[main] Full result for job %u: %s\n", job_id,
+                  cls == s->last_job.cls ? "agrees" : "DISAGREES with the bin chosen");
+        } else if (previous && h >= 0) {
+            s->hosts[h].stats.late++;      // lost the race; already sorted
+        } else {
+            s->stale++;
+            EVLOG("[main] Result for job %u with nothing in flight, ignoring.\n", job_id);
+        }
+        return;
+    }
+
+    s->job.host     = h;
+    s->job.t_result = rx_ns;          // kernel receive time, not when we looked
+    if (h >= 0) s->hosts[h].stats.wins++;
+    actuate(s, cls, conf);
+}
+
+bool sorter_vote_add(sorter_vote_t *v, int frame, int n_frames, sort_class_t cls,
+                     unsigned conf)
+{
+    if (v->seen_mask & (1u << frame)) return false;
+    v->seen_mask |= 1u << frame;
+    v->n_frames = n_frames;
+    v->seen++;
+    v->votes[cls]++;
+    v->conf[cls] += conf;
+    return true;
+}
+
+// Decided once the leader can't be caught by the frames still to come;
+// with everything in, a tie goes to the higher summed confidence.
+sort_class_t sorter_vote_outcome(const sorter_vote_t *v)
+{
+    int best = SORT_NONE + 1;
+    for (int c = best + 1; c < CLASS_MAX; ++c) {
+        if (v->votes[c] > v->votes[best] ||
+            (v->votes[c] == v->votes[best] && v->conf[c] > v->conf[best]))
+            best = c;
+    }
+    int runner = 0;
+    for (int c = SORT_NONE + 1; c < CLASS_MAX; ++c) {
+        if (c != best && v->votes[c] > runner) runner = v->votes[c];
+    }
+
+    int remaining = v->n_frames - v->seen;
+    if (v->votes[best] == 0) return SORT_NONE;      // only "no idea" so far
+    if (v->votes[best] > runner + remaining || remaining == 0)
+        return (sort_class_t)best;
+    return SORT_NONE;
+}
+
+static void handle_frame(sorter_t *s, const sp_frame_t *f, nsec_t rx_ns)
+{
+    int h = (f->host_id < s->cfg.n_hosts) ? f->host_id : -1;
+    sort_class_t cls = class_table_by_id(&s->cfg.classes, f->cls) ? f->cls : SORT_NONE;
+    int n = f->n_frames < SORTER_MAX_FRAMES ? f->n_frames : SORTER_MAX_FRAMES;
+    if (h < 0 || n < 1 || f->frame >= n) {
+        s->unknown++;
+        return;
+    }
+
+    if (!(s->waiting && f->h.job_id == s->job.id)) {
+        if (s->last_job.t_done && f->h.job_id == s->last_job.id) {
+            s->late_frames++;
+            if (cls != s->last_job.cls) s->late_disagree++;
+            EVLOG("[main] Late frame %d/%d for job %u: %s\n", f->frame + 1, n, f->h.job_id,
+                  cls == s->last_job.cls ? "agrees" : "disagrees");
+        } else {
+            s->stale++;
+        }
+        return;
+    }
+
+    sorter_vote_t *v = &s->job.vote[h];
+    if (!sorter_vote_add(v, f->frame, n, cls, f->conf)) return;    // duplicate
+
+    sort_class_t out = sorter_vote_outcome(v);
+    if (out == SORT_NONE) return;
+
+    EVLOG("[main] Job %u decided by host %d after %d of %d frames\n",
+          s->job.id, h, v->seen, n);
+    s->job.frames_used   = v->seen;
+    s->job.frames_total  = n;
+    s->job.t_result_host = f->t_sent;
+    if (v->seen < n) s->early++;
+    handle_class(s, out, (int)(v->conf[out] / (unsigned)v->votes[out]), h, true,
+                 f->h.job_id, rx_ns);
+}
+
+// binary datagrams (sort_proto.h); anything else is a text result
+static void handle_proto(sorter_t *s, const sp_hdr_t *hdr, size_t len,
+                         const struct sockaddr_in *src, nsec_t rx_ns)
+{
+    if (hdr->type == SP_RESULT && len >= sizeof(sp_result_t)) {
+        const sp_result_t *r = (const sp_result_t *)hdr;
+        int h = (r->host_id < s->cfg.n_hosts) ? r->host_id : -1;
+        // a class we don't know is still an answer: reject the item
+        // rather than leave the line waiting on it
+        sort_class_t cls = class_table_by_id(&s->cfg.classes, r->cls) ? r->cls : SORT_NONE;
+        EVLOG("[main] Received: %s (%d) for job %u from host %d\n",
+              class_table_name(&s->cfg.classes, cls), r->cls, r->h.job_id, h);
+        handle_class(s, cls, r->conf, h, true, r->h.job_id, rx_ns);
+    } else if (hdr->type == SP_FRAME && len >= sizeof(sp_frame_t)) {
+        handle_frame(s, (const sp_frame_t *)hdr, rx_ns);
+    } else if (hdr->type == SP_PONG && len >= sizeof(sp_ping_t)) {
+        const sp_ping_t *p = (const sp_ping_t *)hdr;
+        int h = host_by_addr(s, src);
+        if (h >= 0) clock_sync_add(&s->hosts[h].sync, p->t1, p->t2, p->t3, rx_ns);
+    } else if (hdr->type == SP_TIMING && len >= sizeof(sp_timing_t)) {
+        handle_timing(s, host_by_addr(s, src), (const sp_timing_t *)hdr);
+    } else {
+        s->unknown++;
+    }
+}
+
+// one datagram from the result port
+static void handle_result(sorter_t *s, const char *buf, size_t len,
+                          const struct sockaddr_in *src, nsec_t rx_ns)
+{
+    const sp_hdr_t *h = sp_parse(buf, len);
+    if (h) {
+        handle_proto(s, h, len, src, rx_ns);
+        return;
+    }
+
+    EVLOG("[main] Received: '%s'\n", buf);
+
+    // text results are class names ("paper", "plastic", "glass", ...)
+    int cls = class_table_find(&s->cfg.classes, buf, len);
+    if (cls >= 0) {
+        handle_class(s, cls, 0, -1, false, 0, rx_ns);
+    }
+    else {
+        s->unknown++;
+        EVLOG("[main] Unknown classification message, ignoring.\n");
+    }
+}
+
+void sorter_get_split(const sorter_t *s, sorter_split_t *mean)
+{
+    const sorter_split_t *sum = &s->split_sum;
+    memset(mean, 0, sizeof(*mean));
+    mean->count = sum->count;
+    if (!sum->count) return;
+    nsec_t n = (nsec_t)sum->count;
+    mean->net_out   = sum->net_out / n;
+    mean->capture   = sum->capture / n;
+    mean->inference = sum->inference / n;
+    mean->net_back  = sum->net_back / n;
+    mean->actuation = sum->actuation / n;
+}
+
+// Knob events. The press edge starts an item (taken in step 1, like a
+// ctl "capture"); double-click logs the counters and long-press re-homes
+// the servo, both only while nothing is in flight. With click_start_ns
+// >= 0 a CLICK starts the item instead, so the gestures don't start one
+// too, at the cost of the double-click window. Either way job.t_press is
+// the press edge, so that wait shows in the item latency. A start while
+// an item is in flight is kept for when it is done (one at most).
+static void handle_button(sorter_t *s)
+{
+    rotary_event_type_t start = (s->cfg.click_start_ns >= 0) ? ROTARY_EV_CLICK
+                                                             : ROTARY_EV_PRESS;
+    rotary_event_t ev;
+    while (rotaryEncoder_next_event(&ev)) {
+        if (ev.type == start) {
+            if (!s->trigger) {
+                s->trigger   = true;
+                s->trigger_t = ev.t_down_ns;
+            }
+            continue;
+        }
+        if (ev.type == ROTARY_EV_PRESS || ev.type == ROTARY_EV_RELEASE ||
+            ev.type == ROTARY_EV_CLICK || ev.type == ROTARY_EV_REPEAT || s->waiting)
+            continue;
+        EVLOG("[main] Button %s (%lld ms ago)\n",
+              rotaryEncoder_event_name(ev.type), ns_to_ms(ns_since(ev.t_ns)));
+        if (ev.type == ROTARY_EV_DOUBLE_CLICK) {
+            EVLOG("[main] %llu sorted, %llu rejected, next job %u\n",
+                  s->sorted, s->rejected, s->next_id);
+        } else if (ev.type == ROTARY_EV_LONG_PRESS) {
+            servo_to(s, s->cfg.neutral_ns, "neutral");
+        }
+    }
+}
+
+void sorter_step(sorter_t *s)
+{
+    // 0) Keep the RTT / clock offset estimate fresh
+    if (s->cfg.ping_ns > 0 && now_ns() >= s->next_ping) {
+        send_ping(s);
+        s->next_ping = now_ns() + s->cfg.ping_ns;
+    }
+
+    // 1) Rotary button (or a ctl "capture") -> send "start"
+    handle_button(s);
+    bool pressed = !s->waiting && s->trigger;
+    if (pressed) {
+        s->trigger = false;
+        memset(&s->job, 0, sizeof(s->job));
+        s->job.id      = s->next_id++;
+        s->job.host    = -1;
+        s->job.t_press = s->trigger_t;
+        s->hedge_ns    = sorter_hedge_delay(s);     // fixed for this job
+
+        // a parked servo is re-armed now, while the host works, so the
+        // result's write is an ordinary aligned duty change
+        servo_rearm(s->servo);
+
+        EVLOG("[main] Button press detected. Sending 'start' to host.\n");
+        if (send_start_to_host(s, 0) == 0) {
+            s->job.t_sent = s->job.t_sent_host[0];
+            s->waiting = true;
+            EVLOG("[main] Waiting for ML result from host...\n");
+        }
+        sorter_sleep(s, s->cfg.debounce_ns);
+    }
+
+    // 1b) Slow primary -> duplicate the job to the next host
+    if (s->waiting) {
+        maybe_hedge(s);
+    } else {
+        servo_idle(s->servo);       // settled at rest: output off
+    }
+
+    // 2) Drain everything queued on the result port, not one per loop
+    int n;
+    while ((n = udp_rx_drain(&s->rx)) > 0) {
+        for (int i = 0; i < n; ++i) {
+            handle_result(s, s->rx.buf[i], s->rx.len[i], &s->rx.src[i], s->rx.rx_ns[i]);
+        }
+        if (n < UDP_RX_BATCH) break;
+    }
+}
+
+void sorter_run(sorter_t *s, volatile sig_atomic_t *keep_running)
+{
+    EVLOG("[main] Ready. Press encoder button to start.\n");
+    while (*keep_running) {
+        sorter_step(s);
+        sorter_sleep(s, s->cfg.loop_ns); // 5 ms loop
+    }
+}
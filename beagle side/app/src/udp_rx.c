@@ -0,0 +1,167 @@
+// app/src/udp_rx.c
+// recvmmsg() drain with kernel receive timestamps and overflow counters.
+
+#define _GNU_SOURCE
+#include "udp_rx.h"
+
+#include <sys/socket.h>
+#include <linux/sock_diag.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct udp_rx_plumbing {
+    struct mmsghdr msgs[UDP_RX_BATCH];
+    struct iovec   iov[UDP_RX_BATCH];
+    union {
+        struct cmsghdr align;
+        char bytes[CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t))];
+    } ctrl[UDP_RX_BATCH];
+};
+
+int udp_rx_open(udp_rx_t *rx, int port, int rcvbuf_bytes)
+{
+    memset(rx, 0, sizeof(*rx));
+    rx->fd = -1;
+
+    rx->mm = calloc(1, sizeof(*rx->mm));
+    if (!rx->mm) {
+        perror("udp_rx alloc");
+        return -1;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("socket");
+        udp_rx_close(rx);
+        return -1;
+    }
+    rx->fd = sock;
+
+    int enable = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    // room for a burst; the kernel caps this at net.core.rmem_max
+    int want = rcvbuf_bytes > 0 ? rcvbuf_bytes : UDP_RX_RCVBUF;
+    if (setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &want, sizeof(want)) < 0)
+        perror("udp_rx SO_RCVBUF");
+    socklen_t olen = sizeof(rx->stats.rcvbuf);
+    getsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rx->stats.rcvbuf, &olen);
+
+    // ask for a receive timestamp and the drop counter on every datagram
+    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) < 0)
+        perror("udp_rx SO_TIMESTAMPNS");
+    if (setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable)) < 0)
+        perror("udp_rx SO_RXQ_OVFL");
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        udp_rx_close(rx);
+        return -1;
+    }
+
+    // make non-blocking
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags >= 0) {
+        fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+    }
+
+    // the headers point at our own buffers once and for all
+    struct udp_rx_plumbing *mm = rx->mm;
+    for (int i = 0; i < UDP_RX_BATCH; ++i) {
+        mm->iov[i].iov_base = rx->buf[i];
+        mm->iov[i].iov_len  = UDP_RX_MTU;
+        mm->msgs[i].msg_hdr.msg_iov     = &mm->iov[i];
+        mm->msgs[i].msg_hdr.msg_iovlen  = 1;
+        mm->msgs[i].msg_hdr.msg_name    = &rx->src[i];
+    }
+    return 0;
+}
+
+void udp_rx_close(udp_rx_t *rx)
+{
+    if (rx->fd >= 0) {
+        close(rx->fd);
+        rx->fd = -1;
+    }
+    free(rx->mm);
+    rx->mm = NULL;
+}
+
+int udp_rx_drain(udp_rx_t *rx)
+{
+    struct udp_rx_plumbing *mm = rx->mm;
+    if (!mm || rx->fd < 0) return -1;
+
+    // recvmmsg overwrites these, so reset them per call
+    for (int i = 0; i < UDP_RX_BATCH; ++i) {
+        mm->msgs[i].msg_hdr.msg_namelen    = sizeof(rx->src[i]);
+        mm->msgs[i].msg_hdr.msg_control    = mm->ctrl[i].bytes;
+        mm->msgs[i].msg_hdr.msg_controllen = sizeof(mm->ctrl[i].bytes);
+        mm->msgs[i].msg_hdr.msg_flags      = 0;
+    }
+
+    int n = recvmmsg(rx->fd, mm->msgs, UDP_RX_BATCH, MSG_DONTWAIT, NULL);
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+
+    nsec_t now = now_ns();
+    for (int i = 0; i < n; ++i) {
+        struct msghdr *h = &mm->msgs[i].msg_hdr;
+        size_t len = mm->msgs[i].msg_len;
+        if (len > UDP_RX_MTU) len = UDP_RX_MTU;
+        rx->len[i] = len;
+        rx->buf[i][len] = '\0';
+        rx->rx_ns[i] = now;                  // fallback if no timestamp came
+        if (h->msg_flags & MSG_TRUNC) rx->stats.truncated++;
+
+        for (struct cmsghdr *c = CMSG_FIRSTHDR(h); c; c = CMSG_NXTHDR(h, c)) {
+            if (c->cmsg_level != SOL_SOCKET) continue;
+            if (c->cmsg_type == SCM_TIMESTAMPNS) {
+                // the kernel stamps real time; on the virtual clock the
+                // mapping would land up to a loop period late
+                if (timebase_is_virtual()) continue;
+                struct timespec ts;
+                memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                rx->rx_ns[i] = realtime_to_mono_ns(ns_from_timespec(&ts));
+            } else if (c->cmsg_type == SO_RXQ_OVFL) {
+                uint32_t drops;                  // running total for this socket
+                memcpy(&drops, CMSG_DATA(c), sizeof(drops));
+                if (drops > rx->stats.kernel_drops) rx->stats.kernel_drops = drops;
+            }
+        }
+    }
+
+    if (n > 0) {
+        rx->stats.calls++;
+        rx->stats.datagrams += (unsigned long long)n;
+        if ((unsigned long long)n > rx->stats.max_batch) rx->stats.max_batch = (unsigned long long)n;
+    }
+    return n;
+}
+
+void udp_rx_get_stats(const udp_rx_t *rx, udp_rx_stats_t *out)
+{
+    *out = rx->stats;
+}
+
+int udp_rx_queued(const udp_rx_t *rx)
+{
+    uint32_t mem[SK_MEMINFO_VARS];
+    socklen_t len = sizeof(mem);
+    if (getsockopt(rx->fd, SOL_SOCKET, SO_MEMINFO, mem, &len) != 0 ||
+        len <= SK_MEMINFO_RMEM_ALLOC * sizeof(uint32_t))
+        return -1;
+    return (int)mem[SK_MEMINFO_RMEM_ALLOC];
+}
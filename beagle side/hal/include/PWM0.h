@@ -1,9 +1,23 @@
 #ifndef HAL_PWM0_H
 #define HAL_PWM0_H
 
+#include "hal_io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 int  PWM0_init(double freq_hz, double duty);   // enable @ freq (Hz) and duty [0..1]
 int  PWM0_set_duty(double duty);               // change duty [0..1]
 int  PWM0_set_freq(double freq_hz);            // change frequency (Hz), keep duty %
 void PWM0_cleanup(void);                       // disable
 
+// Same, on the hal_io thread (synchronous if it isn't running). A newer
+// call of the same kind supersedes one still queued.
+int  PWM0_set_duty_async(double duty, hal_io_future_t *f);
+int  PWM0_set_freq_async(double freq_hz, hal_io_future_t *f);
+
+#ifdef __cplusplus
+}
+#endif
 #endif
@@ -0,0 +1,39 @@
+#ifndef GESTURE_H
+#define GESTURE_H
+
+// Button gesture recognizer behind rotary.c's events: a pure state
+// machine, fed one button sample and its timestamp at a time (see
+// rotary.h for what each event means). No I/O and no clock of its own,
+// so a sequence of (level, time) samples always gives the same events.
+
+#include "rotary.h"
+#include "timebase.h"
+
+#include <stdbool.h>
+
+#define GESTURE_MAX_OUT 8      // events one step can return; extra REPEATs wait
+
+typedef struct {
+    rotary_gesture_cfg_t cfg;
+    int    raw;          // last sample
+    int    level;        // debounced: 1 = pressed
+    nsec_t t_edge;       // last accepted edge
+    nsec_t t_down;       // press that is (or was last) held
+    nsec_t t_up;         // release of a click still waiting for a second one
+    nsec_t t_click;      // ... its press
+    bool   click_wait;   // ... that one exists
+    bool   second;       // the press being held came within double_click_ns
+    bool   long_sent;
+    int    repeats;
+    nsec_t next_repeat;
+} gesture_t;
+
+// 'level' is the button as first read (1 = pressed, <0 = unknown: up).
+void gesture_init(gesture_t *g, const rotary_gesture_cfg_t *cfg, int level, nsec_t now);
+
+// One sample (raw < 0 = read failed) taken at 'now'. Writes up to
+// GESTURE_MAX_OUT events to out and returns how many; *bounces gets the
+// number of edges ignored as bounce.
+int  gesture_step(gesture_t *g, int raw, nsec_t now, rotary_event_t *out, int *bounces);
+
+#endif
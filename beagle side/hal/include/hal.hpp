@@ -0,0 +1,242 @@
+#ifndef HAL_HPP
+#define HAL_HPP
+
+// Header-only C++17 face of the HAL. No new drivers: every call lands in
+// the same C functions (servo.h, PWM0.h, rotary.h, hal_io.h), and the C
+// ABI underneath is untouched.
+//
+// What it adds is that the configuration becomes part of the type:
+//
+//   using Sg90 = hal::ServoConfig<20000000, 1500000, 1000000, 2000000>;
+//   hal::Servo<Sg90, 0, 0> servo;             // pwmchip0/pwm0, RAII
+//   if (!servo) return servo.error();
+//   servo.pulse<1200000>();                   // range-checked at compile time
+//   servo.right(40);                          // table lookup, built at compile time
+//
+// Ranges are static_assert'ed, clamps fold to constants, the percent ->
+// pulse tables and sysfs paths are computed by the compiler, and every
+// member is a one-line inline forward -- the generated code is the C call
+// with its arguments already worked out. Handles close their device in
+// the destructor and can't be copied or moved (the C side and the hal_io
+// thread hold pointers to them).
+
+#include "servo.h"
+#include "PWM0.h"
+#include "rotary.h"
+#include "hal_io.h"
+#include "timebase.h"
+
+#include <array>
+#include <cstddef>
+
+namespace hal {
+
+// ---- compile-time strings --------------------------------------------
+
+// A NUL-terminated string built by constexpr code.
+template <std::size_t N>
+struct FixedString {
+    char        s[N]{};
+    std::size_t len = 0;
+
+    constexpr void append(const char *p)
+    {
+        while (*p) s[len++] = *p++;
+    }
+    constexpr void append(int v)
+    {
+        char tmp[12]{};
+        int  n = 0;
+        do { tmp[n++] = char('0' + v % 10); v /= 10; } while (v);
+        while (n) s[len++] = tmp[--n];
+    }
+    constexpr const char *c_str() const { return s; }
+};
+
+// /sys/class/pwm/pwmchip<chip>/pwm<channel>[/<leaf>]
+constexpr FixedString<64> pwm_path(int chip, int channel, const char *leaf = "")
+{
+    FixedString<64> p;
+    p.append("/sys/class/pwm/pwmchip");
+    p.append(chip);
+    p.append("/pwm");
+    p.append(channel);
+    if (*leaf) {
+        p.append("/");
+        p.append(leaf);
+    }
+    return p;
+}
+
+template <int Chip, int Channel>
+struct PwmChannel {
+    static_assert(Chip >= 0 && Channel >= 0, "chip and channel are fixed at compile time");
+
+    static constexpr FixedString<64> base       = pwm_path(Chip, Channel);
+    static constexpr FixedString<64> period     = pwm_path(Chip, Channel, "period");
+    static constexpr FixedString<64> duty_cycle = pwm_path(Chip, Channel, "duty_cycle");
+    static constexpr FixedString<64> enable     = pwm_path(Chip, Channel, "enable");
+};
+
+// ---- servo -----------------------------------------------------------
+
+// servo.c's pct_to_ns(), once per percent: both directions use the
+// neutral..max span, exactly as servo_left()/servo_right() do
+constexpr std::array<int, 101> servo_speed_table(int neutral_ns, int max_ns, int dir)
+{
+    int span = max_ns - neutral_ns;
+    std::array<int, 101> t{};
+    for (int pct = 0; pct <= 100; ++pct) {
+        int delta = (span * pct) / 100;
+        t[pct] = dir >= 0 ? neutral_ns + delta : neutral_ns - delta;
+    }
+    return t;
+}
+
+template <int PeriodNs, int NeutralNs, int MinNs, int MaxNs>
+struct ServoConfig {
+    static_assert(PeriodNs > 0, "period must be positive");
+    static_assert(MinNs > 0 && MinNs <= NeutralNs && NeutralNs <= MaxNs,
+                  "need 0 < min <= neutral <= max");
+    static_assert(MaxNs < PeriodNs, "pulse must fit in the period");
+
+    static constexpr int period_ns  = PeriodNs;
+    static constexpr int neutral_ns = NeutralNs;
+    static constexpr int min_ns     = MinNs;
+    static constexpr int max_ns     = MaxNs;
+
+    static constexpr int clamp(int ns)
+    {
+        return ns < MinNs ? MinNs : ns > MaxNs ? MaxNs : ns;
+    }
+
+    static constexpr std::array<int, 101> right_ns = servo_speed_table(NeutralNs, MaxNs, +1);
+    static constexpr std::array<int, 101> left_ns  = servo_speed_table(NeutralNs, MaxNs, -1);
+};
+
+template <class Config, int Chip = 0, int Channel = 0>
+class Servo {
+public:
+    using config  = Config;
+    using channel = PwmChannel<Chip, Channel>;
+
+    Servo()
+        : rc_(servo_init(&s_, Chip, Channel, Config::period_ns, Config::neutral_ns,
+                         Config::min_ns, Config::max_ns)) {}
+
+    // Export and bring-up on the hal_io thread; usable once f is done.
+    // f (if given) must outlive the Servo: the destructor waits on it, so
+    // the bring-up is never still running when the channel is closed.
+    explicit Servo(hal_io_future_t *f)
+        : f_(f ? f : &own_),
+          rc_(servo_init_async(&s_, Chip, Channel, Config::period_ns, Config::neutral_ns,
+                               Config::min_ns, Config::max_ns, f_)) {}
+
+    ~Servo()
+    {
+        if (f_) hal_io_wait(f_, 0);
+        servo_close(&s_);
+    }
+
+    Servo(const Servo &)            = delete;
+    Servo &operator=(const Servo &) = delete;
+
+    // servo_init()'s return. For the async constructor: the bring-up's
+    // once the future is done, until then only whether it was queued.
+    explicit operator bool() const { return error() == 0; }
+    int error() const { return (rc_ == 0 && f_ && hal_io_done(f_)) ? f_->rc : rc_; }
+
+    int pulse(int ns)         { return servo_set_pulse_ns(&s_, Config::clamp(ns)); }
+    int pulse_aligned(int ns) { return servo_set_pulse_aligned(&s_, Config::clamp(ns)); }
+    int pulse_async(int ns, hal_io_future_t *f = nullptr)
+    {
+        return servo_set_pulse_async(&s_, Config::clamp(ns), f);
+    }
+
+    template <int Ns>
+    int pulse()
+    {
+        static_assert(Ns >= Config::min_ns && Ns <= Config::max_ns, "pulse out of range");
+        return servo_set_pulse_ns(&s_, Ns);
+    }
+
+    int right(int pct) { return servo_set_pulse_ns(&s_, Config::right_ns[clamp_pct(pct)]); }
+    int left(int pct)  { return servo_set_pulse_ns(&s_, Config::left_ns[clamp_pct(pct)]); }
+    int stop()         { return servo_set_pulse_ns(&s_, Config::neutral_ns); }
+
+    const ServoTiming &timing() const { return s_.timing; }
+
+    // The C handle, for anything not wrapped here (e.g. sorter_init()).
+    ::Servo       *get()       { return &s_; }
+    const ::Servo *get() const { return &s_; }
+
+private:
+    static constexpr int clamp_pct(int pct) { return pct < 0 ? 0 : pct > 100 ? 100 : pct; }
+
+    hal_io_future_t  own_{};              // when the caller passes no future
+    hal_io_future_t *f_ = nullptr;        // async bring-up, else null
+    ::Servo          s_;
+    int              rc_;
+};
+
+// ---- PWM0 (single channel, found at init) ----------------------------
+
+template <int FreqHz>
+class Pwm0 {
+public:
+    static_assert(FreqHz > 0 && FreqHz <= 1000000, "PWM0 runs 1 Hz .. 1 MHz");
+    static constexpr long long period_ns = NS_PER_SEC / FreqHz;
+
+    explicit Pwm0(double duty = 0.5) : rc_(PWM0_init(FreqHz, duty)) {}
+    ~Pwm0() { PWM0_cleanup(); }
+
+    Pwm0(const Pwm0 &)            = delete;
+    Pwm0 &operator=(const Pwm0 &) = delete;
+
+    explicit operator bool() const { return rc_ == 0; }
+    int error() const { return rc_; }
+
+    int duty(double d) { return PWM0_set_duty(d); }
+    int duty_async(double d, hal_io_future_t *f = nullptr) { return PWM0_set_duty_async(d, f); }
+
+private:
+    int rc_;
+};
+
+// ---- the rest: start in the constructor, stop in the destructor --------
+
+class RotaryEncoder {
+public:
+    RotaryEncoder() : rc_(rotaryEncoder_init()) {}
+    ~RotaryEncoder() { rotaryEncoder_cleanup(); }
+
+    RotaryEncoder(const RotaryEncoder &)            = delete;
+    RotaryEncoder &operator=(const RotaryEncoder &) = delete;
+
+    explicit operator bool() const { return rc_ == 0; }
+
+    int  position() const { return rotaryEncoder_get_position(); }
+    int  velocity() const { return rotaryEncoder_get_velocity(); }
+    bool pressed()        { return rotaryEncoder_button_pressed(); }
+
+private:
+    int rc_;
+};
+
+class IoThread {
+public:
+    IoThread() : rc_(hal_io_start()) {}
+    ~IoThread() { hal_io_stop(); }           // runs what is still queued first
+
+    IoThread(const IoThread &)            = delete;
+    IoThread &operator=(const IoThread &) = delete;
+
+    explicit operator bool() const { return rc_ == 0; }
+
+private:
+    int rc_;
+};
+
+}  // namespace hal
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef QUAD_DECODER_H
+#define QUAD_DECODER_H
+
+// Table-driven quadrature decoder.
+// The previous and current AB states form a 4-bit index into a 16-entry
+// table giving the step (+1, -1 or 0). Index values where BOTH bits
+// changed are illegal: samples were missed, and the knob moved 2, 6, 10...
+// counts (2 mod 4). Those are counted as errors and, when the direction
+// of motion is known, credited in that direction: as many counts as the
+// recent edge rate predicts for the time since the last poll, rounded to
+// the nearest 2 + 4k.
+
+#include "timebase.h"
+
+#include <stdint.h>
+
+extern const int8_t quad_lut_step[16];   // +1 / -1 / 0
+extern const int8_t quad_lut_bad[16];    // 1 where both bits changed
+
+#define QUAD_MAX_LOST  1026   // most counts one illegal transition is credited
+
+typedef struct {
+    uint8_t  last;        // previous AB state (0..3)
+    int8_t   dir;         // direction of the last valid step, 0 = unknown
+    int32_t  pos;         // decoded position incl. estimated corrections
+    uint32_t steps;       // valid transitions seen
+    uint32_t errors;      // illegal (double-step) transitions seen
+    int32_t  lost_est;    // signed counts credited on errors
+    nsec_t   last_t;      // time of the previous sample
+    int64_t  rate_edges;  // counts moved, x256, decaying by 1/8 per poll
+    nsec_t   rate_ns;     // ... over this much time, decaying alike
+} quad_decoder_t;
+
+void quad_decoder_init(quad_decoder_t *q, unsigned state, nsec_t now);
+
+// Counts to credit for an illegal transition dt after the previous sample.
+int quad_decoder_lost(const quad_decoder_t *q, nsec_t dt);
+
+// Feeds one AB sample (a<<1 | b) taken at now. Returns the position change.
+// Only the (rare) illegal transition branches: cheap enough to run per
+// sample at any poll rate.
+static inline int quad_decoder_step(quad_decoder_t *q, unsigned state, nsec_t now)
+{
+    unsigned idx = ((unsigned)q->last << 2) | (state & 3u);
+    int d   = quad_lut_step[idx];
+    int bad = quad_lut_bad[idx];
+    nsec_t dt = now - q->last_t;
+    int est = bad ? quad_decoder_lost(q, dt) : 0;
+    int moved = d + est;
+
+    q->last        = (uint8_t)(state & 3u);
+    q->dir         = (int8_t)(d ? d : q->dir);
+    q->pos        += moved;
+    q->steps      += (uint32_t)(d != 0);
+    q->errors     += (uint32_t)bad;
+    q->lost_est   += est;
+    q->last_t      = now;
+    q->rate_edges += (int64_t)(moved < 0 ? -moved : moved) * 256 - (q->rate_edges >> 3);
+    q->rate_ns    += dt - (q->rate_ns >> 3);
+    return moved;
+}
+
+#endif
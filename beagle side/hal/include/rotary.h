@@ -3,16 +3,127 @@
 
 #include <stdbool.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 int  rotaryEncoder_init(void);
 void rotaryEncoder_cleanup(void);
 
 // Signed value: increments CW, decrements CCW
 int  rotaryEncoder_get_position(void);
 
+// Counts per second (signed), averaged over the last 100 ms
+int  rotaryEncoder_get_velocity(void);
+
 // Return true exactly once per debounced button press
 bool rotaryEncoder_button_pressed(void);
 
+// ---- button gestures ---------------------------------------------------
+// The encoder thread turns the button's edge timestamps into events:
+//   PRESS / RELEASE   on the debounced edge (<= 1 poll after it)
+//   LONG_PRESS        held for long_press_ns
+//   REPEAT            then every repeat_ns while still held (0 = off)
+//   CLICK             a short press with no second one within double_click_ns
+//                     (so it comes double_click_ns after the release; with
+//                     double_click_ns 0, on the release and no DOUBLE_CLICK)
+//   DOUBLE_CLICK      on the second short press's release
+// Debounce is leading-edge: an edge counts at once, then the line is
+// ignored for debounce_ns, so it adds no delay to PRESS/RELEASE. Every
+// event carries the time it nominally happened; the poll that reports it
+// is at most one period later, whatever else the app is doing.
+// rotaryEncoder_button_pressed() keeps working alongside (one per PRESS).
+// The recognizer itself is gesture.h, a pure function of the samples.
+
+typedef enum {
+    ROTARY_EV_PRESS = 0,
+    ROTARY_EV_RELEASE,
+    ROTARY_EV_CLICK,
+    ROTARY_EV_DOUBLE_CLICK,
+    ROTARY_EV_LONG_PRESS,
+    ROTARY_EV_REPEAT,
+} rotary_event_type_t;
+
+typedef struct {
+    rotary_event_type_t type;
+    int       repeat;           // REPEAT: 1, 2, ...
+    long long t_ns;             // now_ns() when it happened (edge or threshold)
+    long long held_ns;          // RELEASE / LONG_PRESS / REPEAT: since the press
+    long long t_down_ns;        // the press this event belongs to
+} rotary_event_t;
+
+typedef struct {
+    long long debounce_ns;      // edges closer than this after one are bounce
+    long long long_press_ns;
+    long long double_click_ns;  // release -> next press, at most (0 = no double-click)
+    long long repeat_ns;        // after LONG_PRESS; 0 = no REPEAT events
+} rotary_gesture_cfg_t;
+
+#define ROTARY_EVENT_QUEUE 32   // events not yet taken; more are dropped
+
+void rotaryEncoder_gesture_defaults(rotary_gesture_cfg_t *cfg);   // 50/800/300/150 ms
+void rotaryEncoder_set_gestures(const rotary_gesture_cfg_t *cfg);
+
+// Oldest pending event. false if there is none.
+bool rotaryEncoder_next_event(rotary_event_t *ev);
+
+const char *rotaryEncoder_event_name(rotary_event_type_t t);
+
 // Set logical position (optional helper)
 void rotaryEncoder_set_position(int v);
 
+// Illegal transitions (both A and B changed between two polls) so far.
+// Each one is credited as two steps in the direction of motion.
+unsigned rotaryEncoder_get_missed_steps(void);
+
+// Quadrature edges per mechanical revolution (20 detents x 4 edges).
+#define ROTARY_COUNTS_PER_REV 80
+
+// ---- polling rate --------------------------------------------------------
+// Without edge interrupts the thread polls the lines. Fixed by default
+// (1 kHz). Adaptive: poll every idle_ns while nothing happens, jump to
+// active_ns on the first transition, non-zero velocity, button edge or
+// held button, and once quiet for hold_ns decay back (the period doubles
+// each poll).
+// The first edges of a fast turn made at the idle rate can be missed:
+// missed_idle counts those, missed_steps all of them.
+typedef struct {
+    long long idle_ns;          // e.g. 20 ms
+    long long active_ns;        // e.g. 200 us (5 kHz)
+    long long hold_ns;          // quiet this long -> start slowing down
+} rotary_poll_cfg_t;
+
+void rotaryEncoder_poll_fixed(rotary_poll_cfg_t *cfg);      // 1 ms, the default
+void rotaryEncoder_poll_adaptive(rotary_poll_cfg_t *cfg);   // 20 ms / 5 kHz / 300 ms
+void rotaryEncoder_set_polling(const rotary_poll_cfg_t *cfg);
+
+typedef struct {
+    unsigned long long polls;
+    unsigned long long steps;        // valid transitions decoded
+    unsigned long long missed_steps; // both bits changed between two polls
+    long long poll_period_ns;        // poll interval right now
+    long long active_period_ns;      // fastest it polls (what max_reliable_rpm uses)
+    unsigned long long active_polls; // polls made at the active rate
+    unsigned long long missed_idle;  // missed_steps caught by a slower poll
+    double    active_pct;            // share of the time spent at the active rate
+    double    cpu_pct;               // encoder thread CPU time / wall time
+    long long max_late_ns;           // worst wake-up lateness of a poll
+    long long mean_late_ns;
+    long long min_edge_ns;           // shortest gap between two edges (0 = none)
+    double    max_reliable_rpm;      // fastest speed the current polling can follow
+    double    observed_max_rpm;      // fastest speed actually seen
+    unsigned long long events;       // button gestures queued
+    unsigned long long events_dropped;   // queue full (nobody reading)
+    unsigned long long bounces;      // button edges ignored as bounce
+} rotary_stats_t;
+
+// Snapshot of the polling statistics (since the last reset). If
+// observed_max_rpm gets close to max_reliable_rpm, or missed_steps grows,
+// the poll is losing counts; cpu_pct is what the polling costs.
+void rotaryEncoder_get_stats(rotary_stats_t *out);
+void rotaryEncoder_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
 #endif
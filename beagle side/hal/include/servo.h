@@ -3,10 +3,38 @@
 
 #include <stdbool.h>
 
+#include "hal_io.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define SERVO_HIST_BINS 20
+
+/* Write-timing instrumentation, updated by every duty write.
+   Phase is measured from the moment the output was enabled, which is
+   when the hardware PWM period starts counting. */
+typedef struct {
+    unsigned long long writes;
+    long long enable_ns;                   // phase reference (now_ns() at enable)
+    long long last_sched_ns;               // when the last write was meant to happen
+    long long last_start_ns;               // when it actually started
+    long long last_dur_ns;                 // how long the sysfs write took
+    long long max_late_ns;
+    long long max_dur_ns;
+    long long sum_dur_ns;
+    long long last_period;                 // PWM period index of the last write
+    unsigned  bunched;                     // writes landing in the same period as the previous one
+    unsigned  phase_hist[SERVO_HIST_BINS]; // start time within the period, period/20 per bin
+    unsigned  late_hist[SERVO_HIST_BINS];  // lateness, bin k = [2^(k-1), 2^k) us, bin 0 = <1 us
+    unsigned  dur_hist[SERVO_HIST_BINS];   // write duration, same log2 us bins
+    unsigned  parks;                       // outputs disabled by servo_idle()/servo_park()
+    unsigned  rearms;                      // ... and enabled again
+    unsigned  rearm_full;                  // re-arms that had to redo period + duty
+    long long last_rearm_ns;               // due -> output live again
+    long long max_rearm_ns;
+} ServoTiming;
+
 typedef struct {
     int  chip;          // pwmchipN (we’ll default to 0; override via PWM0_CHIP env)
     int  channel;       // pwmM (always 0 here)
@@ -16,6 +44,12 @@ typedef struct {
     int  max_ns;        // e.g., 2_000_000
     char base[256];     // "/sys/class/pwm/pwmchipN/pwmM"
     bool enabled;
+    bool parked;        // output off after idling; period and duty still loaded
+    int  duty_ns;       // last duty written: what a re-arm restores
+    long long idle_off_ns;     // park after this long without a write (0 = never)
+    long long last_write_ns;   // now_ns() of the last duty write
+    ServoTiming timing;
+    hal_io_coalesce_t duty_io;   // newest servo_set_pulse_async()
 } Servo;
 
 /* Initialize the servo at /sys/class/pwm/pwmchip{chip}/pwm{channel}.
@@ -24,6 +58,12 @@ int  servo_init(Servo *s,
                 int chip, int channel,
                 int period_ns, int neutral_ns, int min_ns, int max_ns);
 
+/* Fills in *s (paths, limits) without touching sysfs; servo_init() is
+   this plus export and bring-up. Same chip < 0 rule. */
+void servo_setup(Servo *s,
+                 int chip, int channel,
+                 int period_ns, int neutral_ns, int min_ns, int max_ns);
+
 /* Convenience motions for continuous or positional servos */
 int  servo_left (Servo *s, int pct);   // 0..100 (maps around neutral)
 int  servo_right(Servo *s, int pct);   // 0..100
@@ -32,6 +72,48 @@ int  servo_stop (Servo *s);            // go to neutral
 /* Set exact pulse width in nanoseconds. Clamped to [min_ns, max_ns]. */
 int  servo_set_pulse_ns(Servo *s, int duty_ns);
 
+/* Same, but the write is scheduled for 'sched_ns' (now_ns() time). Sleeps
+   until then if it's in the future; lateness is measured against it. */
+int  servo_set_pulse_ns_at(Servo *s, int duty_ns, long long sched_ns);
+
+/* Schedules the write just after the next PWM period boundary, so the new
+   duty never lands mid-pulse and two updates can't share a period. Waits
+   at most one period. */
+int  servo_set_pulse_aligned(Servo *s, int duty_ns);
+
+/* First PWM period boundary at or after 't_ns'. */
+long long servo_next_boundary_ns(const Servo *s, long long t_ns);
+
+/* Clear / log the timing histograms. */
+void servo_timing_reset(Servo *s);
+void servo_timing_report(const Servo *s);
+
+/* Async versions (hal_io.h): the export wait and the bring-up writes, or
+   an aligned duty write, run on the I/O thread instead of the caller's.
+   servo_init_async() fills in *s right away; leave it alone until f is
+   done. A newer servo_set_pulse_async() supersedes one still queued, so
+   only the latest target is written. Don't mix these with the synchronous
+   calls (or servo_idle/park/rearm) on the same Servo: nothing locks it. */
+int  servo_init_async(Servo *s,
+                      int chip, int channel,
+                      int period_ns, int neutral_ns, int min_ns, int max_ns,
+                      hal_io_future_t *f);
+int  servo_set_pulse_async(Servo *s, int duty_ns, hal_io_future_t *f);
+
+/* Idle-off. A servo left at a position keeps hunting around it and
+   drawing current for as long as pulses arrive. servo_idle(), called from
+   the app's loop, disables the output once nothing has been written for
+   'settle_ns' (0 = never). Disabling keeps period and duty loaded, so the
+   next write re-arms in the minimum: the duty (only if it changed) ahead
+   of time, then one enable write when the write was due -- the same one
+   sysfs write a normal duty change costs at that instant. If the channel
+   lost its setup meanwhile the full period/duty/enable sequence is redone.
+   Re-arm latency is kept in ServoTiming. */
+void servo_set_idle_off(Servo *s, long long settle_ns);
+int  servo_idle(Servo *s);             // 1 if it parked the output now
+int  servo_park(Servo *s);             // output off now, state kept
+int  servo_rearm(Servo *s);            // output on again at the cached duty
+
 /* Disable output and unexport channel. */
 int  servo_close(Servo *s);
 
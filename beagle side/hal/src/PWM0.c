@@ -2,6 +2,8 @@
 
 #include <math.h>
 #include "PWM0.h"
+#include "timebase.h"
+#include "evlog.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -12,7 +14,6 @@
 #include <errno.h>
 #include <limits.h>
 #include <glob.h>
-#include <time.h>
 
 static long long read_ll(const char *path);
 
@@ -34,11 +35,6 @@ static int write_ll(const char *path, long long v)
     if (n < 0 || n >= (int)sizeof(buf)) return -1;
     return write_str(path, buf);
 }
-static void msleep(int ms)
-{
-    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
-    nanosleep(&ts, NULL);
-}
 // Build dst = a + b (no formatting), with bounds check. Returns 0 on ok.
 static int path_join2(char *dst, size_t dstsz, const char *a, const char *b)
 {
@@ -72,7 +68,7 @@ static int probe_find_pwm(void)
 
     glob_t g = (glob_t){0};
     if (glob("/sys/class/pwm/pwmchip*", 0, NULL, &g) != 0) {
-        errno = ENODEV; perror("no /sys/class/pwm/pwmchip*"); return -1;
+        errno = ENODEV; EVLOG("no /sys/class/pwm/pwmchip*: %s\n", strerror(errno)); return -1;
     }
 
     for (size_t i = 0; i < g.gl_pathc; ++i) {
@@ -83,7 +79,7 @@ static int probe_find_pwm(void)
 
         if (!path_exists(pwm0)) {
             (void)write_str(exportf, "0");
-            for (int t = 0; t < 50 && !path_exists(pwm0); ++t) msleep(10);
+            for (int t = 0; t < 50 && !path_exists(pwm0); ++t) sleep_ms(10);
         }
         if (!path_exists(pwm0)) continue;
 
@@ -103,7 +99,7 @@ static int probe_find_pwm(void)
 
     globfree(&g);
     errno = ENODEV;
-    perror("no usable pwmchip*/pwm0 found");
+    EVLOG("no usable pwmchip*/pwm0 found: %s\n", strerror(errno));
     return -1;
 }
 
@@ -129,28 +125,28 @@ int PWM0_init(double hz, double duty)
     for (int attempt = 0; attempt < 3; ++attempt) {
         // 1) hard-off
         (void)write_ll(enable, 0);
-        msleep(2);
+        sleep_ms(2);
 
         // 2) prime duty to tiny value so any new period is valid
         //    (prevents EINVAL when period < old duty)
         (void)write_ll(dutyf, 1);
-        msleep(1);
+        sleep_ms(1);
 
         // 3) program period for requested Hz
         if (write_ll(period, per_ns) != 0) {            // <-- where your EINVAL happened
-            msleep(2);
+            sleep_ms(2);
             continue;  // retry
         }
 
         // 4) set bounded duty for that new period
         if (write_ll(dutyf, dty_ns) != 0) {
-            msleep(2);
+            sleep_ms(2);
             continue;  // retry
         }
 
         // 5) enable
         if (write_ll(enable, 1) != 0) {
-            msleep(2);
+            sleep_ms(2);
             continue;  // retry
         }
 
@@ -161,7 +157,7 @@ int PWM0_init(double hz, double duty)
     }
 
     // If we got here, bring-up failed
-    perror("PWM0_init");
+    EVLOG("PWM0_init: %s\n", strerror(errno));
     errno = EINVAL;
     return -1;
 }
@@ -188,7 +184,7 @@ int PWM0_set_freq(double hz)
     long long was_enabled = read_ll(enable);
     if (was_enabled == 0) {
         (void)write_ll(enable, 1);
-        msleep(2); // let sysfs settle
+        sleep_ms(2); // let sysfs settle
         was_enabled = 1;
     } else if (was_enabled < 0) {
         // if we couldn't read, assume enabled
@@ -217,25 +213,25 @@ int PWM0_set_freq(double hz)
     // ---- FALLBACK: brief disable, program, re-enable
     for (int attempt = 0; attempt < 2; ++attempt) {
         (void)write_ll(enable, 0);
-        msleep(1);
+        sleep_ms(1);
 
         // Prime away from rails, then program
         (void)write_ll(dutyf, 1);
         if (write_ll(period, new_per) == 0 && write_ll(dutyf, new_dty) == 0) {
             if (write_ll(enable, 1) != 0) continue;
-            msleep(1);
+            sleep_ms(1);
             g_period_ns = new_per;
             g_duty_frac = (double)new_dty / (double)new_per;
             return 0;
         }
 
         // back-off and try once more
-        msleep(1);
+        sleep_ms(1);
         (void)write_ll(enable, 1);
-        msleep(1);
+        sleep_ms(1);
     }
 
-    perror("PWM0_set_freq: could not program");
+    EVLOG("PWM0_set_freq: could not program: %s\n", strerror(errno));
     errno = EINVAL;
     return -1;
 }
@@ -265,15 +261,31 @@ int PWM0_set_duty(double duty)
         long long was_enabled = read_ll(enable);
         if (was_enabled < 0) was_enabled = 1;
         (void)write_ll(enable, 0);
-        msleep(1);
+        sleep_ms(1);
         (void)write_ll(dutyf, 1);
         int ok = (write_ll(dutyf, dc) == 0);
         if (was_enabled) (void)write_ll(enable, 1);
-        if (!ok) { perror("set duty_cycle"); return -1; }
+        if (!ok) { EVLOG("set duty_cycle: %s\n", strerror(errno)); return -1; }
     }
     return 0;
 }
 
+// ---- async (hal_io) ----------------------------------------------------
+static hal_io_coalesce_t g_duty_io, g_freq_io;
+
+static int duty_cmd(void *ctx, hal_io_arg_t a) { (void)ctx; return PWM0_set_duty(a.d); }
+static int freq_cmd(void *ctx, hal_io_arg_t a) { (void)ctx; return PWM0_set_freq(a.d); }
+
+int PWM0_set_duty_async(double duty, hal_io_future_t *f)
+{
+    return hal_io_submit(duty_cmd, NULL, (hal_io_arg_t){ .d = duty }, &g_duty_io, f);
+}
+
+int PWM0_set_freq_async(double hz, hal_io_future_t *f)
+{
+    return hal_io_submit(freq_cmd, NULL, (hal_io_arg_t){ .d = hz }, &g_freq_io, f);
+}
+
 void PWM0_cleanup(void)
 {
     if (g_pwm_dir[0] == '\0') return;
@@ -0,0 +1,91 @@
+#include "gesture.h"
+
+#include <string.h>
+
+typedef struct {
+    rotary_event_t *ev;
+    int             n;
+} out_t;
+
+static void emit(out_t *o, rotary_event_type_t type, nsec_t t, nsec_t t_down, int repeat)
+{
+    nsec_t held = (type == ROTARY_EV_PRESS || type == ROTARY_EV_CLICK) ? 0 : t - t_down;
+    if (o->n < GESTURE_MAX_OUT)
+        o->ev[o->n++] = (rotary_event_t){ type, repeat, t, held, t_down };
+}
+
+void gesture_init(gesture_t *g, const rotary_gesture_cfg_t *cfg, int level, nsec_t now)
+{
+    memset(g, 0, sizeof(*g));
+    g->cfg   = *cfg;
+    g->raw   = level > 0;
+    g->level = level > 0;
+    // as if the last edge was one debounce ago: the very first real press
+    // counts, and nothing is measured against time zero
+    g->t_edge = now - g->cfg.debounce_ns;
+}
+
+int gesture_step(gesture_t *g, int raw, nsec_t now, rotary_event_t *out, int *bounces)
+{
+    out_t o = { out, 0 };
+    *bounces = 0;
+    bool settled = now - g->t_edge >= g->cfg.debounce_ns;
+    if (raw < 0) raw = g->raw;           // read failed: keep the last sample
+    if (raw != g->raw && !settled) (*bounces)++;
+    g->raw = raw;
+
+    // leading edge: take it now, ignore the line for debounce_ns. A level
+    // that changed during the lockout is taken when the lockout ends.
+    if (raw != g->level && settled) {
+        g->level  = raw;
+        g->t_edge = now;
+        if (raw) {
+            g->second = g->click_wait && now - g->t_up <= g->cfg.double_click_ns;
+            if (g->click_wait && !g->second)   // window ran out this very poll
+                emit(&o, ROTARY_EV_CLICK, g->t_up + g->cfg.double_click_ns, g->t_click, 0);
+            g->click_wait  = false;
+            g->t_down      = now;
+            g->long_sent   = false;
+            g->repeats     = 0;
+            emit(&o, ROTARY_EV_PRESS, now, now, 0);
+        } else {
+            emit(&o, ROTARY_EV_RELEASE, now, g->t_down, 0);
+            if (g->long_sent) {
+                // a long press is never part of a click
+            } else if (g->second) {
+                emit(&o, ROTARY_EV_DOUBLE_CLICK, now, g->t_down, 0);
+            } else if (g->cfg.double_click_ns <= 0) {
+                emit(&o, ROTARY_EV_CLICK, now, g->t_down, 0);   // no window to wait out
+            } else {
+                g->click_wait = true;
+                g->t_up       = now;
+                g->t_click    = g->t_down;
+            }
+            g->second = false;
+        }
+    }
+
+    if (g->level) {
+        nsec_t t_long = g->t_down + g->cfg.long_press_ns;
+        if (!g->long_sent && now >= t_long) {
+            if (g->second) {
+                // the first press was a click after all
+                emit(&o, ROTARY_EV_CLICK, g->t_up + g->cfg.double_click_ns, g->t_click, 0);
+                g->second = false;
+            }
+            emit(&o, ROTARY_EV_LONG_PRESS, t_long, g->t_down, 0);
+            g->long_sent   = true;
+            g->next_repeat = t_long + g->cfg.repeat_ns;
+        }
+        // a late poll catches up, a few per step
+        while (g->long_sent && g->cfg.repeat_ns > 0 && now >= g->next_repeat &&
+               o.n < GESTURE_MAX_OUT) {
+            emit(&o, ROTARY_EV_REPEAT, g->next_repeat, g->t_down, ++g->repeats);
+            g->next_repeat += g->cfg.repeat_ns;
+        }
+    } else if (g->click_wait && now - g->t_up > g->cfg.double_click_ns) {
+        emit(&o, ROTARY_EV_CLICK, g->t_up + g->cfg.double_click_ns, g->t_click, 0);
+        g->click_wait = false;
+    }
+    return o.n;
+}
@@ -0,0 +1,43 @@
+#include "quad_decoder.h"
+
+// Index = (last << 2) | state, states in Gray order 00 -> 01 -> 11 -> 10 -> 00 (+1).
+const int8_t quad_lut_step[16] = {
+    /* 00-> */  0, +1, -1,  0,
+    /* 01-> */ -1,  0,  0, +1,
+    /* 10-> */ +1,  0,  0, -1,
+    /* 11-> */  0, -1, +1,  0,
+};
+
+const int8_t quad_lut_bad[16] = {
+    /* 00-> */  0,  0,  0,  1,
+    /* 01-> */  0,  0,  1,  0,
+    /* 10-> */  0,  1,  0,  0,
+    /* 11-> */  1,  0,  0,  0,
+};
+
+void quad_decoder_init(quad_decoder_t *q, unsigned state, nsec_t now)
+{
+    q->last       = (uint8_t)(state & 3u);
+    q->dir        = 0;
+    q->pos        = 0;
+    q->steps      = 0;
+    q->errors     = 0;
+    q->lost_est   = 0;
+    q->last_t     = now;
+    q->rate_edges = 0;
+    q->rate_ns    = 0;
+}
+
+int quad_decoder_lost(const quad_decoder_t *q, nsec_t dt)
+{
+    if (!q->dir) return 0;
+
+    // expected counts since the last sample, x256 (in double: a long
+    // stall times a fast knob overflows 64 bits); the nearest 2 + 4k is
+    // 2 + 4 * floor(expected / 4)
+    double expect = (q->rate_ns > 0 && dt > 0)
+                  ? (double)q->rate_edges * (double)dt / (double)q->rate_ns : 0.0;
+    double k = expect / (4 * 256);
+    if (k > QUAD_MAX_LOST / 4) k = QUAD_MAX_LOST / 4;
+    return q->dir * (2 + 4 * (int)k);
+}
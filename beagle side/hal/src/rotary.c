@@ -1,4 +1,7 @@
 #include "rotary.h"
+#include "gesture.h"
+#include "quad_decoder.h"
+#include "timebase.h"
 #include <pthread.h>
 #include <stdatomic.h>
 #include <stdbool.h>
@@ -7,7 +10,6 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
-#include <time.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
@@ -15,13 +17,46 @@
 #define ENC_B_GPIO  336
 #define ENC_SW_GPIO 434
 
+#define ENC_POLL_NS     (1 * NS_PER_MS)   // ~1 kHz polling (fixed mode)
+#define ENC_IDLE_NS     (20 * NS_PER_MS)  // adaptive: nothing happening
+#define ENC_ACTIVE_NS   (200 * NS_PER_US) // adaptive: 5 kHz while turning
+#define ENC_HOLD_NS     (300 * NS_PER_MS) // adaptive: quiet this long -> slow down
+#define ENC_DEBOUNCE_NS (50 * NS_PER_MS)
+#define ENC_LONG_NS     (800 * NS_PER_MS)
+#define ENC_DOUBLE_NS   (300 * NS_PER_MS)
+#define ENC_REPEAT_NS   (150 * NS_PER_MS)
+#define ENC_VEL_NS      (100 * NS_PER_MS) // velocity averaging window
+
 static atomic_int g_pos = 0;
 static atomic_int g_run = 0;
 static atomic_int g_button_edge = 0;   // <-- set on debounced rising edge
+static atomic_int g_vel = 0;           // counts/s over the last window
 static pthread_t  g_thread;
 
+// timing statistics, written by the encoder thread once per poll
+static pthread_mutex_t g_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static rotary_stats_t  g_stats;
+static long long       g_late_sum_ns = 0;
+static nsec_t          g_active_ns = 0;     // time polled at the active rate
+static nsec_t          g_wall0, g_cpu0;     // at the last reset
+
+// polling rate: set under g_stats_lock, picked up on the next poll
+static rotary_poll_cfg_t g_poll = { ENC_POLL_NS, ENC_POLL_NS, 0 };
+static atomic_int        g_poll_changed = 0;
+
 static int fd_a = -1, fd_b = -1, fd_sw = -1;
 
+// gesture events: single-producer (encoder thread) / single-consumer ring
+static rotary_event_t g_ev[ROTARY_EVENT_QUEUE];
+static atomic_uint    g_ev_head = 0;   // next to write (encoder thread)
+static atomic_uint    g_ev_tail = 0;   // next to read (the app)
+
+// thresholds: set under g_stats_lock, picked up by the thread on its next poll
+static rotary_gesture_cfg_t g_gcfg_new = {
+    ENC_DEBOUNCE_NS, ENC_LONG_NS, ENC_DOUBLE_NS, ENC_REPEAT_NS
+};
+static atomic_int           g_gcfg_changed = 0;
+
 /* ---------- tiny sysfs helpers ---------- */
 static int sysfs_write(const char *path, const char *s)
 {
@@ -70,6 +105,30 @@ static int gpio_open_value(int n)
     return open(p, O_RDONLY);
 }
 
+/* ---------- gestures ---------- */
+// queues what gesture_step() recognised; PRESS also latches the edge
+// rotaryEncoder_button_pressed() reports
+static void publish(const rotary_event_t *ev, int n)
+{
+    unsigned long long queued = 0, dropped = 0;
+    for (int i = 0; i < n; ++i) {
+        unsigned head = atomic_load_explicit(&g_ev_head, memory_order_relaxed);
+        unsigned tail = atomic_load_explicit(&g_ev_tail, memory_order_acquire);
+        if (head - tail >= ROTARY_EVENT_QUEUE) {
+            dropped++;
+        } else {
+            g_ev[head % ROTARY_EVENT_QUEUE] = ev[i];
+            atomic_store_explicit(&g_ev_head, head + 1, memory_order_release);
+            queued++;
+        }
+        if (ev[i].type == ROTARY_EV_PRESS) atomic_store(&g_button_edge, 1);
+    }
+    pthread_mutex_lock(&g_stats_lock);
+    g_stats.events         += queued;
+    g_stats.events_dropped += dropped;
+    pthread_mutex_unlock(&g_stats_lock);
+}
+
 /* ---------- encoder thread ---------- */
 static void *encoder_thread(void *unused)
 {
@@ -77,43 +136,113 @@ static void *encoder_thread(void *unused)
 
     int a = sysfs_read_int(fd_a);
     int b = sysfs_read_int(fd_b);
-    int last = (a<<1) | b;
+    quad_decoder_t dec;
+    quad_decoder_init(&dec, (unsigned)((a<<1) | b), now_ns());
+
+    rotary_gesture_cfg_t gc;
+    pthread_mutex_lock(&g_stats_lock);
+    gc = g_gcfg_new;
+    atomic_store(&g_gcfg_changed, 0);
+    pthread_mutex_unlock(&g_stats_lock);
+    gesture_t btn;
+    gesture_init(&btn, &gc, sysfs_read_int(fd_sw), now_ns());
 
-    int last_sw = sysfs_read_int(fd_sw);
-    struct timespec last_sw_time = {0};
+    // polls sit on an absolute grid so lateness can be measured
+    nsec_t deadline  = now_ns();
+    nsec_t last_edge = 0;
+    nsec_t vel_t0    = deadline;
+    int    vel_pos0  = atomic_load(&g_pos);
+
+    pthread_mutex_lock(&g_stats_lock);
+    rotary_poll_cfg_t pc = g_poll;
+    pthread_mutex_unlock(&g_stats_lock);
+    nsec_t period      = pc.idle_ns;
+    nsec_t last_active = deadline;
 
     while (atomic_load(&g_run)) {
-        usleep(1000); // ~1 kHz polling
+        if (atomic_exchange(&g_poll_changed, 0)) {
+            pthread_mutex_lock(&g_stats_lock);
+            pc = g_poll;
+            pthread_mutex_unlock(&g_stats_lock);
+            period = pc.idle_ns;
+        }
+
+        deadline += period;
+        sleep_until_ns(deadline);
+        nsec_t woke = now_ns();
+        nsec_t late = woke - deadline;
+        if (late >= period) {
+            deadline = woke;    // a whole slot lost: restart the grid here
+        }
 
         a = sysfs_read_int(fd_a);
         b = sysfs_read_int(fd_b);
-        int state = (a<<1) | b;
-
-        // Gray-code transitions: 00->01->11->10->00 : +1 (and reverse is -1)
-        int diff = (last<<2) | state;
-        switch (diff) {
-            case 0x1: case 0x7: case 0xE: case 0x8: // +1
-                atomic_fetch_add(&g_pos, 1); break;
-            case 0x2: case 0x4: case 0xD: case 0xB: // -1
-                atomic_fetch_sub(&g_pos, 1); break;
-            default: break; // ignore glitches
+
+        // Gray-code transitions: 00->01->11->10->00 : +1 (and reverse is -1).
+        // A jump across two states means we polled too slowly; the decoder
+        // counts it and credits what the recent speed says was missed.
+        uint32_t errs = dec.errors;
+        int delta = quad_decoder_step(&dec, (unsigned)((a<<1) | b), woke);
+        if (delta) atomic_fetch_add(&g_pos, delta);
+
+        if (woke - vel_t0 >= ENC_VEL_NS) {
+            int pos = atomic_load(&g_pos);
+            atomic_store(&g_vel, (int)((long long)(pos - vel_pos0) * NS_PER_SEC / (woke - vel_t0)));
+            vel_t0   = woke;
+            vel_pos0 = pos;
         }
-        last = state;
-
-        // Button: rising-edge with ~50ms debounce
-        int sw = sysfs_read_int(fd_sw);
-        if (sw != last_sw) {
-            struct timespec now;
-            clock_gettime(CLOCK_MONOTONIC, &now);
-            long long dt_ms =
-                (now.tv_sec - last_sw_time.tv_sec)*1000LL +
-                (now.tv_nsec - last_sw_time.tv_nsec)/1000000LL;
-            last_sw_time = now;
-            last_sw = sw;
-            if (sw == 1 && dt_ms > 50) {
-                atomic_store(&g_button_edge, 1); // <-- publish press
+
+        // Button: edges -> press/release/click/... events
+        if (atomic_exchange(&g_gcfg_changed, 0)) {
+            pthread_mutex_lock(&g_stats_lock);
+            btn.cfg = g_gcfg_new;
+            pthread_mutex_unlock(&g_stats_lock);
+        }
+        nsec_t t_btn = btn.t_edge;
+        rotary_event_t ev[GESTURE_MAX_OUT];
+        int bounces;
+        int nev = gesture_step(&btn, sysfs_read_int(fd_sw), woke, ev, &bounces);
+        if (nev) publish(ev, nev);
+
+        // rate for the next poll: anything moving -> active at once,
+        // quiet for hold_ns -> double the period back up to idle
+        nsec_t used = period;
+        bool busy = delta || dec.errors != errs || atomic_load(&g_vel) != 0 ||
+                    btn.t_edge != t_btn || bounces || btn.level;
+        if (busy) {
+            last_active = woke;
+            if (period != pc.active_ns) {
+                period   = pc.active_ns;
+                deadline = woke;        // next poll one active period from now
+            }
+        } else if (period < pc.idle_ns && woke - last_active >= pc.hold_ns) {
+            period = (period * 2 < pc.idle_ns) ? period * 2 : pc.idle_ns;
+        }
+
+        pthread_mutex_lock(&g_stats_lock);
+        g_stats.polls++;
+        g_stats.bounces += (unsigned long long)bounces;
+        g_stats.poll_period_ns = period;
+        if (used == pc.active_ns) {
+            g_stats.active_polls++;
+            g_active_ns += used;
+        }
+        g_late_sum_ns += late;
+        if (late > g_stats.max_late_ns) g_stats.max_late_ns = late;
+        if (dec.errors != errs) {
+            g_stats.missed_steps++;
+            if (used > pc.active_ns) g_stats.missed_idle++;
+        }
+        if (delta) {
+            g_stats.steps++;
+            if (last_edge) {
+                nsec_t gap = woke - last_edge;
+                if (g_stats.min_edge_ns == 0 || gap < g_stats.min_edge_ns)
+                    g_stats.min_edge_ns = gap;
             }
+            last_edge = woke;
         }
+        pthread_mutex_unlock(&g_stats_lock);
     }
     return NULL;
 }
@@ -142,6 +271,9 @@ int rotaryEncoder_init(void)
 
     atomic_store(&g_pos, 0);
     atomic_store(&g_button_edge, 0);
+    atomic_store(&g_vel, 0);
+    atomic_store(&g_ev_tail, atomic_load(&g_ev_head));
+    rotaryEncoder_reset_stats();
     atomic_store(&g_run, 1);
     if (pthread_create(&g_thread, NULL, encoder_thread, NULL) != 0) {
         perror("rotEnc pthread_create");
@@ -166,13 +298,133 @@ int rotaryEncoder_get_position(void)
     return atomic_load(&g_pos);
 }
 
+int rotaryEncoder_get_velocity(void)
+{
+    return atomic_load(&g_vel);
+}
+
 void rotaryEncoder_set_position(int v)
 {
     atomic_store(&g_pos, v);
 }
 
+unsigned rotaryEncoder_get_missed_steps(void)
+{
+    pthread_mutex_lock(&g_stats_lock);
+    unsigned n = (unsigned)g_stats.missed_steps;
+    pthread_mutex_unlock(&g_stats_lock);
+    return n;
+}
+
+// RPM at which consecutive edges are 'interval' apart
+static double rpm_for_interval(long long interval_ns)
+{
+    if (interval_ns <= 0) return 0.0;
+    return 60.0 * 1e9 / ((double)interval_ns * ROTARY_COUNTS_PER_REV);
+}
+
+// CPU time the encoder thread has used (0 if it isn't running)
+static nsec_t thread_cpu_ns(void)
+{
+    clockid_t cid;
+    struct timespec t;
+    if (!atomic_load(&g_run) || pthread_getcpuclockid(g_thread, &cid) != 0 ||
+        clock_gettime(cid, &t) != 0)
+        return 0;
+    return ns_from_timespec(&t);
+}
+
+void rotaryEncoder_get_stats(rotary_stats_t *out)
+{
+    pthread_mutex_lock(&g_stats_lock);
+    *out = g_stats;
+    out->mean_late_ns = g_stats.polls ? g_late_sum_ns / (long long)g_stats.polls : 0;
+    out->active_period_ns = g_poll.active_ns;
+    nsec_t wall   = now_ns() - g_wall0;
+    nsec_t cpu    = thread_cpu_ns() - g_cpu0;
+    nsec_t active = g_active_ns;
+    pthread_mutex_unlock(&g_stats_lock);
+
+    if (!out->poll_period_ns) out->poll_period_ns = g_poll.idle_ns;
+    out->active_pct = wall > 0 ? 100.0 * (double)active / (double)wall : 0.0;
+    out->cpu_pct    = (wall > 0 && cpu > 0) ? 100.0 * (double)cpu / (double)wall : 0.0;
+
+    // Every Gray state must be seen by at least one poll, so the worst
+    // gap between two polls at the fastest rate bounds the edge rate we
+    // can follow (once escalated).
+    out->max_reliable_rpm = rpm_for_interval(out->active_period_ns + out->max_late_ns);
+    out->observed_max_rpm = rpm_for_interval(out->min_edge_ns);
+}
+
+void rotaryEncoder_reset_stats(void)
+{
+    pthread_mutex_lock(&g_stats_lock);
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_late_sum_ns = 0;
+    g_active_ns   = 0;
+    g_wall0 = now_ns();
+    g_cpu0  = thread_cpu_ns();
+    pthread_mutex_unlock(&g_stats_lock);
+}
+
+void rotaryEncoder_poll_fixed(rotary_poll_cfg_t *cfg)
+{
+    cfg->idle_ns   = ENC_POLL_NS;
+    cfg->active_ns = ENC_POLL_NS;
+    cfg->hold_ns   = 0;
+}
+
+void rotaryEncoder_poll_adaptive(rotary_poll_cfg_t *cfg)
+{
+    cfg->idle_ns   = ENC_IDLE_NS;
+    cfg->active_ns = ENC_ACTIVE_NS;
+    cfg->hold_ns   = ENC_HOLD_NS;
+}
+
+void rotaryEncoder_set_polling(const rotary_poll_cfg_t *cfg)
+{
+    if (cfg->active_ns <= 0 || cfg->idle_ns < cfg->active_ns) return;
+    pthread_mutex_lock(&g_stats_lock);
+    g_poll = *cfg;
+    pthread_mutex_unlock(&g_stats_lock);
+    atomic_store(&g_poll_changed, 1);
+}
+
 bool rotaryEncoder_button_pressed(void)
 {
     // return true once per debounced press
     return atomic_exchange(&g_button_edge, 0) != 0;
 }
+
+void rotaryEncoder_gesture_defaults(rotary_gesture_cfg_t *cfg)
+{
+    cfg->debounce_ns     = ENC_DEBOUNCE_NS;
+    cfg->long_press_ns   = ENC_LONG_NS;
+    cfg->double_click_ns = ENC_DOUBLE_NS;
+    cfg->repeat_ns       = ENC_REPEAT_NS;
+}
+
+void rotaryEncoder_set_gestures(const rotary_gesture_cfg_t *cfg)
+{
+    pthread_mutex_lock(&g_stats_lock);
+    g_gcfg_new = *cfg;
+    pthread_mutex_unlock(&g_stats_lock);
+    atomic_store(&g_gcfg_changed, 1);
+}
+
+bool rotaryEncoder_next_event(rotary_event_t *ev)
+{
+    unsigned tail = atomic_load_explicit(&g_ev_tail, memory_order_relaxed);
+    if (tail == atomic_load_explicit(&g_ev_head, memory_order_acquire)) return false;
+    *ev = g_ev[tail % ROTARY_EVENT_QUEUE];
+    atomic_store_explicit(&g_ev_tail, tail + 1, memory_order_release);
+    return true;
+}
+
+const char *rotaryEncoder_event_name(rotary_event_type_t t)
+{
+    static const char *const names[] = {
+        "press", "release", "click", "double-click", "long-press", "repeat",
+    };
+    return (unsigned)t < sizeof(names) / sizeof(names[0]) ? names[t] : "?";
+}
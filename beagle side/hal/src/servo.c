@@ -1,5 +1,7 @@
 #define _GNU_SOURCE
 #include "servo.h"
+#include "timebase.h"
+#include "evlog.h"
 
 #include <errno.h>
 #include <fcntl.h>
@@ -7,7 +9,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
-#include <time.h>
 #include <unistd.h>
 
 static int write_str(const char *path, const char *val)
@@ -64,13 +65,50 @@ static int export_pwm(int chip, int channel)
 
     // Wait a bit for sysfs to create the pwmN directory
     for (int i = 0; i < 50 && !exists(pwm_path); ++i) {
-        struct timespec ts = {0, 20 * 1000 * 1000}; // 20 ms
-        nanosleep(&ts, NULL);
+        sleep_ms(20);
     }
 
     return exists(pwm_path) ? 0 : rc;
 }
 
+// Guard after a period boundary before an aligned write goes out
+#define SERVO_ALIGN_GUARD_NS (200 * NS_PER_US)
+
+// log2 bucket of a duration in microseconds; bin 0 is "under 1 us"
+static int log2_us_bin(long long ns)
+{
+    long long us = ns / NS_PER_US;
+    int bin = 0;
+    while (us > 0 && bin < SERVO_HIST_BINS - 1) { us >>= 1; ++bin; }
+    return bin;
+}
+
+static void record_write(Servo *s, nsec_t sched, nsec_t start, nsec_t end)
+{
+    ServoTiming *t = &s->timing;
+    nsec_t late = start - sched;
+    nsec_t dur  = end - start;
+
+    t->writes++;
+    t->last_sched_ns = sched;
+    t->last_start_ns = start;
+    t->last_dur_ns   = dur;
+    t->sum_dur_ns   += dur;
+    if (late > t->max_late_ns) t->max_late_ns = late;
+    if (dur  > t->max_dur_ns)  t->max_dur_ns  = dur;
+    t->late_hist[log2_us_bin(late)]++;
+    t->dur_hist[log2_us_bin(dur)]++;
+
+    if (s->period_ns > 0 && start >= t->enable_ns) {
+        long long since  = start - t->enable_ns;
+        long long period = since / s->period_ns;
+        long long phase  = since % s->period_ns;
+        t->phase_hist[(phase * SERVO_HIST_BINS) / s->period_ns]++;
+        if (t->writes > 1 && period == t->last_period) t->bunched++;
+        t->last_period = period;
+    }
+}
+
 static int clamp(int v, int lo, int hi)
 {
     if (v < lo) return lo;
@@ -89,12 +127,10 @@ static int pct_to_ns(const Servo *s, int pct, int dir)
         : (s->neutral_ns - delta);
 }
 
-int servo_init(Servo *s,
-               int chip, int channel,
-               int period_ns, int neutral_ns, int min_ns, int max_ns)
+void servo_setup(Servo *s,
+                 int chip, int channel,
+                 int period_ns, int neutral_ns, int min_ns, int max_ns)
 {
-    if (!s) return -EINVAL;
-
     // Allow override via env PWM0_CHIP when caller passes chip<0
     if (chip < 0) {
         const char *env = getenv("PWM0_CHIP");
@@ -112,13 +148,14 @@ int servo_init(Servo *s,
     s->neutral_ns  = neutral_ns;
     s->min_ns      = min_ns;
     s->max_ns      = max_ns;
-
-    int rc = export_pwm(chip, channel);
-    if (rc) return rc;
-
     snprintf(s->base, sizeof(s->base),
              "/sys/class/pwm/pwmchip%d/pwm%d", chip, channel);
+}
 
+// the bring-up sequence on an exported channel, ending at duty_ns
+static int program(Servo *s, int duty_ns)
+{
+    int rc;
     char p_period[320], p_enable[320], p_duty[320], p_polarity[320];
     snprintf(p_period,  sizeof(p_period),  "%s/period",      s->base);
     snprintf(p_enable,  sizeof(p_enable),  "%s/enable",      s->base);
@@ -135,23 +172,215 @@ int servo_init(Servo *s,
     }
 
     if ((rc = write_int(p_period, s->period_ns)))  return rc;
-    if ((rc = write_int(p_duty,   s->neutral_ns))) return rc;
+    if ((rc = write_int(p_duty,   duty_ns)))       return rc;
     if ((rc = write_int(p_enable, 1)))             return rc;
 
-    s->enabled = true;
+    s->timing.enable_ns = now_ns();
+    s->enabled       = true;
+    s->parked        = false;
+    s->duty_ns       = duty_ns;
+    s->last_write_ns = s->timing.enable_ns;
     return 0;
 }
 
-int servo_set_pulse_ns(Servo *s, int duty_ns)
+// export, then the bring-up sequence
+static int servo_bringup(Servo *s)
+{
+    int rc = export_pwm(s->chip, s->channel);
+    if (rc) return rc;
+    return program(s, s->neutral_ns);
+}
+
+int servo_init(Servo *s,
+               int chip, int channel,
+               int period_ns, int neutral_ns, int min_ns, int max_ns)
+{
+    if (!s) return -EINVAL;
+    servo_setup(s, chip, channel, period_ns, neutral_ns, min_ns, max_ns);
+    return servo_bringup(s);
+}
+
+static int bringup_cmd(void *ctx, hal_io_arg_t a)
+{
+    (void)a;
+    return servo_bringup(ctx);
+}
+
+int servo_init_async(Servo *s,
+                     int chip, int channel,
+                     int period_ns, int neutral_ns, int min_ns, int max_ns,
+                     hal_io_future_t *f)
+{
+    if (!s) return -EINVAL;
+    servo_setup(s, chip, channel, period_ns, neutral_ns, min_ns, max_ns);
+    return hal_io_submit(bringup_cmd, s, (hal_io_arg_t){ .i = 0 }, NULL, f);
+}
+
+// Output back on at duty_ns, live at 'sched' (see servo.h).
+static int rearm_at(Servo *s, int duty_ns, nsec_t sched)
+{
+    char p_duty[320], p_enable[320];
+    snprintf(p_duty,   sizeof(p_duty),   "%s/duty_cycle", s->base);
+    snprintf(p_enable, sizeof(p_enable), "%s/enable",     s->base);
+
+    nsec_t due = now_ns();
+    if (sched > due) due = sched;
+
+    // nothing moves while the output is off, so the duty can go early
+    int rc = (duty_ns != s->duty_ns) ? write_int(p_duty, duty_ns) : 0;
+    if (sched > now_ns()) sleep_until_ns(sched);
+
+    nsec_t start = now_ns();
+    if (rc == 0) rc = write_int(p_enable, 1);
+    if (rc == 0) {
+        s->timing.enable_ns = start;     // the period restarts on enable
+        s->parked  = false;
+        s->duty_ns = duty_ns;
+    } else {
+        // re-exported or reset under us: the whole sequence again
+        s->timing.rearm_full++;
+        rc = program(s, duty_ns);
+    }
+    nsec_t end = now_ns();
+
+    ServoTiming *t = &s->timing;
+    t->last_period = -1;                  // new phase reference, nothing to bunch with
+    record_write(s, sched, start, end);
+    s->last_write_ns = end;
+    t->rearms++;
+    t->last_rearm_ns = end - due;
+    if (t->last_rearm_ns > t->max_rearm_ns) t->max_rearm_ns = t->last_rearm_ns;
+    return rc;
+}
+
+int servo_set_pulse_ns_at(Servo *s, int duty_ns, long long sched_ns)
 {
     if (!s || !s->enabled) return -EIO;
 
     duty_ns = clamp(duty_ns, s->min_ns, s->max_ns);
+    if (s->parked) return rearm_at(s, duty_ns, sched_ns);
 
     char p_duty[320];
     snprintf(p_duty, sizeof(p_duty), "%s/duty_cycle", s->base);
 
-    return write_int(p_duty, duty_ns);
+    if (sched_ns > now_ns()) sleep_until_ns(sched_ns);
+
+    nsec_t start = now_ns();
+    int rc = write_int(p_duty, duty_ns);
+    nsec_t end = now_ns();
+    record_write(s, sched_ns, start, end);
+    if (rc == 0) s->duty_ns = duty_ns;
+    s->last_write_ns = end;
+    return rc;
+}
+
+int servo_set_pulse_ns(Servo *s, int duty_ns)
+{
+    return servo_set_pulse_ns_at(s, duty_ns, now_ns());
+}
+
+static int pulse_cmd(void *ctx, hal_io_arg_t a)
+{
+    return servo_set_pulse_aligned(ctx, (int)a.i);
+}
+
+int servo_set_pulse_async(Servo *s, int duty_ns, hal_io_future_t *f)
+{
+    if (!s) return -EINVAL;
+    return hal_io_submit(pulse_cmd, s, (hal_io_arg_t){ .i = duty_ns }, &s->duty_io, f);
+}
+
+long long servo_next_boundary_ns(const Servo *s, long long t_ns)
+{
+    if (!s || s->period_ns <= 0 || t_ns <= s->timing.enable_ns) return t_ns;
+    long long since = t_ns - s->timing.enable_ns;
+    long long rem   = since % s->period_ns;
+    return rem ? t_ns + (s->period_ns - rem) : t_ns;
+}
+
+int servo_set_pulse_aligned(Servo *s, int duty_ns)
+{
+    if (!s) return -EINVAL;
+    if (s->parked) return servo_set_pulse_ns_at(s, duty_ns, now_ns());   // no period running
+    nsec_t now = now_ns();
+    nsec_t at  = servo_next_boundary_ns(s, now) + SERVO_ALIGN_GUARD_NS;
+    if (at - s->period_ns >= now) at -= s->period_ns;   // this period's slot is still ahead
+    // one write per period: if the last one already used it, take the next
+    if (s->timing.writes && s->timing.last_start_ns >= at - SERVO_ALIGN_GUARD_NS)
+        at += s->period_ns;
+    return servo_set_pulse_ns_at(s, duty_ns, at);
+}
+
+void servo_set_idle_off(Servo *s, long long settle_ns)
+{
+    if (s) s->idle_off_ns = settle_ns > 0 ? settle_ns : 0;
+}
+
+int servo_park(Servo *s)
+{
+    if (!s || !s->enabled) return -EIO;
+    if (s->parked) return 0;
+
+    char p_enable[320];
+    snprintf(p_enable, sizeof(p_enable), "%s/enable", s->base);
+    int rc = write_int(p_enable, 0);
+    if (rc == 0) {
+        s->parked = true;
+        s->timing.parks++;
+    }
+    return rc;
+}
+
+int servo_rearm(Servo *s)
+{
+    if (!s || !s->enabled) return -EIO;
+    return s->parked ? rearm_at(s, s->duty_ns, now_ns()) : 0;
+}
+
+int servo_idle(Servo *s)
+{
+    if (!s || !s->enabled || s->parked || s->idle_off_ns <= 0) return 0;
+    if (now_ns() - s->last_write_ns < s->idle_off_ns) return 0;
+    return servo_park(s) == 0;
+}
+
+void servo_timing_reset(Servo *s)
+{
+    if (!s) return;
+    long long enable_ns = s->timing.enable_ns;
+    memset(&s->timing, 0, sizeof(s->timing));
+    s->timing.enable_ns = enable_ns;
+}
+
+static void report_hist(const char *name, const unsigned *h, bool log2_bins, int period_ns)
+{
+    for (int i = 0; i < SERVO_HIST_BINS; ++i) {
+        if (!h[i]) continue;
+        if (log2_bins) {
+            long long lo = i ? (1LL << (i - 1)) : 0;
+            EVLOG("[servo]   %s %lld-%lld us: %u\n", name, lo, 1LL << i, h[i]);
+        } else {
+            long long w = period_ns / SERVO_HIST_BINS;
+            EVLOG("[servo]   %s %lld-%lld us: %u\n", name, (i * w) / 1000, ((i + 1) * w) / 1000, h[i]);
+        }
+    }
+}
+
+void servo_timing_report(const Servo *s)
+{
+    if (!s) return;
+    const ServoTiming *t = &s->timing;
+    if (!t->writes) return;
+    EVLOG("[servo] %llu writes, mean %lld us, max %lld us long\n",
+          t->writes, ns_to_us(t->sum_dur_ns / (long long)t->writes), ns_to_us(t->max_dur_ns));
+    EVLOG("[servo] max late %lld us, %u writes bunched into one %d us period\n",
+          ns_to_us(t->max_late_ns), t->bunched, s->period_ns / 1000);
+    if (t->parks || t->rearms)
+        EVLOG("[servo] parked %u times, re-armed %u (%u full), worst re-arm %lld us\n",
+              t->parks, t->rearms, t->rearm_full, ns_to_us(t->max_rearm_ns));
+    report_hist("phase", t->phase_hist, false, s->period_ns);
+    report_hist("late ", t->late_hist,  true,  s->period_ns);
+    report_hist("write", t->dur_hist,   true,  s->period_ns);
 }
 
 int servo_right(Servo *s, int speed_pct)
@@ -185,5 +414,6 @@ int servo_close(Servo *s)
 
     write_int(unexp, s->channel);
     s->enabled = false;
+    s->parked  = false;
     return 0;
 }
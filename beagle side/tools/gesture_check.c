@@ -0,0 +1,111 @@
+// tools/gesture_check.c
+// Feeds button sample sequences to the gesture recognizer (hal/gesture.h)
+// at a 1 ms poll and checks the events that come out, in order.
+//
+// A script is a list of (time, level) steps: the level holds from that
+// time until the next step; the run goes on to the last step's time.
+// Besides the event order, every event has to name the right press:
+// RELEASE the last PRESS, CLICK the press of the last RELEASE.
+
+#include "gesture.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define POLL_NS   NS_PER_MS
+#define MAX_EVENTS 64
+
+typedef struct { long ms; int level; } step_t;
+
+typedef struct {
+    const char   *name;
+    step_t        steps[16];
+    int           n_steps;
+    const char   *expect;       // event initials: P R C D L r
+    int           min_bounces;
+    bool          no_window;    // double_click_ns 0
+} case_t;
+
+static char initial(rotary_event_type_t t)
+{
+    switch (t) {
+    case ROTARY_EV_PRESS:        return 'P';
+    case ROTARY_EV_RELEASE:      return 'R';
+    case ROTARY_EV_CLICK:        return 'C';
+    case ROTARY_EV_DOUBLE_CLICK: return 'D';
+    case ROTARY_EV_LONG_PRESS:   return 'L';
+    case ROTARY_EV_REPEAT:       return 'r';
+    }
+    return '?';
+}
+
+static int run(const case_t *c)
+{
+    rotary_gesture_cfg_t cfg = {
+        .debounce_ns     = 50 * NS_PER_MS,
+        .long_press_ns   = 800 * NS_PER_MS,
+        .double_click_ns = c->no_window ? 0 : 300 * NS_PER_MS,
+        .repeat_ns       = 150 * NS_PER_MS,
+    };
+    gesture_t g;
+    gesture_init(&g, &cfg, 0, 0);
+
+    char   got[MAX_EVENTS + 1] = { 0 };
+    int    n = 0, bounces = 0;
+    nsec_t last = -1, t_pressed = -1, t_released_down = -1;
+    int    ok = 1;
+    long   end = c->steps[c->n_steps - 1].ms;
+    int    k = 0;
+
+    for (long ms = 1; ms <= end; ++ms) {
+        while (k + 1 < c->n_steps && c->steps[k + 1].ms <= ms) k++;
+        rotary_event_t ev[GESTURE_MAX_OUT];
+        int b;
+        int m = gesture_step(&g, c->steps[k].level, ms * POLL_NS, ev, &b);
+        bounces += b;
+        for (int i = 0; i < m && n < MAX_EVENTS; ++i) {
+            if (ev[i].t_ns < last || ev[i].t_ns > ms * POLL_NS) ok = 0;   // out of order / future
+            last = ev[i].t_ns;
+            got[n++] = initial(ev[i].type);
+            if (ev[i].type == ROTARY_EV_PRESS) {
+                t_pressed = ev[i].t_ns;
+            } else if (ev[i].type == ROTARY_EV_RELEASE) {
+                if (ev[i].t_down_ns != t_pressed) ok = 0;
+                t_released_down = ev[i].t_down_ns;
+            } else if (ev[i].type == ROTARY_EV_CLICK) {
+                if (ev[i].t_down_ns != t_released_down) ok = 0;
+            }
+        }
+    }
+
+    if (strcmp(got, c->expect) != 0 || bounces < c->min_bounces) ok = 0;
+    printf("[gesture] %-22s %-12s %s\n", c->name, got, ok ? "ok" : "FAIL");
+    if (!ok) printf("          expected %s, bounces %d (>= %d)\n", c->expect, bounces, c->min_bounces);
+    return ok;
+}
+
+int main(void)
+{
+    static const case_t cases[] = {
+        { "click",            { {0,0}, {100,1}, {200,0}, {800,0} }, 4, "PRC", 0 },
+        { "click with bounce", { {0,0}, {100,1}, {102,0}, {104,1}, {200,0}, {203,1},
+                                 {206,0}, {800,0} }, 8, "PRC", 4 },
+        { "short press",      { {0,0}, {100,1}, {130,0}, {800,0} }, 4, "PRC", 0 },
+        { "double click",     { {0,0}, {100,1}, {200,0}, {350,1}, {450,0}, {1000,0} }, 6,
+                              "PRPRD", 0 },
+        { "two clicks",       { {0,0}, {100,1}, {200,0}, {700,1}, {800,0}, {1400,0} }, 6,
+                              "PRCPRC", 0 },
+        { "long press",       { {0,0}, {100,1}, {1250,0}, {1600,0} }, 4, "PLrrR", 0 },
+        { "click then long",  { {0,0}, {100,1}, {200,0}, {350,1}, {1400,0}, {1800,0} }, 6,
+                              "PRPCLrR", 0 },
+        { "no window: click",  { {0,0}, {100,1}, {200,0}, {400,0} }, 4, "PRC", 0, true },
+        { "no window: two",    { {0,0}, {100,1}, {200,0}, {350,1}, {450,0}, {800,0} }, 6,
+                              "PRCPRC", 0, true },
+        { "no window: long",   { {0,0}, {100,1}, {1000,0}, {1200,0} }, 4, "PLR", 0, true },
+    };
+    int n = (int)(sizeof(cases) / sizeof(cases[0]));
+    int pass = 0;
+    for (int i = 0; i < n; ++i) pass += run(&cases[i]);
+    printf("[gesture] %d/%d passed\n", pass, n);
+    return pass == n ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+// Checks hal.hpp against the C HAL it wraps. Most of it is static_asserts,
+// so a successful build is most of the test; the run compares the
+// compile-time sysfs path with the one the real servo_setup() builds
+// (no export or bring-up, so it is safe on a Beagle).
+//
+// Code size: with -O2, s.right(pct) is the percent clamp, one load from
+// the constant table and a tail call to servo_set_pulse_ns(); the C
+// version calls servo_right(), which does the same sums at runtime. Compare
+//   objdump -d --no-show-raw-insn tools/CMakeFiles/hal_cpp_check.dir/hal_cpp_check.cpp.o
+// for cpp_right() against c_right() below.
+
+#include "hal.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+using Sg90 = hal::ServoConfig<20000000, 1500000, 1000000, 2000000>;
+using Ch   = hal::PwmChannel<0, 1>;
+
+static_assert(Sg90::clamp(0) == 1000000 && Sg90::clamp(3000000) == 2000000);
+static_assert(Sg90::clamp(1234567) == 1234567);
+static_assert(Sg90::right_ns[0] == 1500000 && Sg90::right_ns[100] == 2000000);
+static_assert(Sg90::left_ns[40] == 1300000);
+static_assert(Ch::duty_cycle.len == sizeof("/sys/class/pwm/pwmchip0/pwm1/duty_cycle") - 1);
+static_assert(Ch::base.s[22] == '0' && Ch::base.s[27] == '1');
+
+// what a C caller writes today
+extern "C" __attribute__((noinline)) int c_right(Servo *s, int pct)
+{
+    return servo_right(s, pct);
+}
+
+__attribute__((noinline)) int cpp_right(hal::Servo<Sg90, 0, 1> &s, int pct)
+{
+    return s.right(pct);
+}
+
+int main(void)
+{
+    Servo raw;
+    servo_setup(&raw, 0, 1, Sg90::period_ns, Sg90::neutral_ns, Sg90::min_ns, Sg90::max_ns);
+    char duty[sizeof(raw.base) + sizeof("/duty_cycle")];
+    std::snprintf(duty, sizeof(duty), "%s/duty_cycle", raw.base);   // as program() does
+
+    bool ok = std::strcmp(raw.base, Ch::base.c_str()) == 0 &&
+              std::strcmp(duty, Ch::duty_cycle.c_str()) == 0;
+    std::printf("[hal_cpp] base %s (%s)\n", Ch::base.c_str(), ok ? "matches servo_setup()" : raw.base);
+    std::printf("[hal_cpp] right 40%% = %d ns, left 40%% = %d ns\n",
+                Sg90::right_ns[40], Sg90::left_ns[40]);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+// tools/journal_read.c
+// Trends from the sorter's event journal (app/include/journal.h).
+//
+// usage: journal_read [FILE] [--bucket hour|day|MINUTES] [--tail N]
+//   FILE defaults to $SORTER_JOURNAL or sorter.journal. Safe to run
+//   against a journal the sorter is still writing.
+//
+// Per bucket of wall-clock time: items, rejects, throughput while busy
+// (first press to last item done), item latency (press -> back at
+// neutral) and host latency (start sent -> result) percentiles, and the
+// share decided early on streamed frames.
+
+#include "journal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NS_PER_MS   1000000LL
+#define NS_PER_MIN  (60LL * 1000000000LL)
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_wall(const void *a, const void *b)
+{
+    const journal_rec_t *x = a, *y = b;
+    return (x->t_wall > y->t_wall) - (x->t_wall < y->t_wall);
+}
+
+static double pct_ms(int64_t *v, size_t n, int pct)
+{
+    if (n == 0) return 0;
+    qsort(v, n, sizeof(v[0]), cmp_i64);
+    return (double)v[(n * (size_t)pct) / 100] / NS_PER_MS;
+}
+
+static void fmt_wall(int64_t wall_ns, char *buf, size_t len)
+{
+    time_t t = (time_t)(wall_ns / 1000000000LL);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    strftime(buf, len, "%Y-%m-%d %H:%M", &tm);
+}
+
+// one bucket's worth of records; label NULL = the bucket's start time
+static void print_bucket(const char *label, const journal_rec_t *r, size_t n,
+                         int64_t *item, int64_t *host)
+{
+    size_t rejected = 0, early = 0, nh = 0;
+    int64_t busy = 0;
+    for (size_t i = 0; i < n; ++i) {
+        item[i] = r[i].t_done - r[i].t_press;
+        if (r[i].t_result && r[i].t_sent) host[nh++] = r[i].t_result - r[i].t_sent;
+        rejected += r[i].outcome == JOURNAL_REJECTED;
+        early    += r[i].frames_used && r[i].frames_used < r[i].frames_total;
+    }
+    // busy span in wall time: first press to the last item's done
+    const journal_rec_t *last = &r[n - 1];
+    busy = (last->t_wall + (last->t_done - last->t_press)) - r[0].t_wall;
+
+    char when[32];
+    fmt_wall(r[0].t_wall, when, sizeof(when));
+    printf("%-17s %7zu %8zu %9.1f %8.0f %6.0f %8.0f %6.0f %5.0f%%\n",
+           label ? label : when, n, rejected,
+           busy > 0 ? (double)n * NS_PER_MIN / (double)busy : 0.0,
+           pct_ms(item, n, 50), pct_ms(item, n, 95),
+           pct_ms(host, nh, 50), pct_ms(host, nh, 95),
+           100.0 * (double)early / (double)n);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    int64_t bucket_ns = 60 * NS_PER_MIN;
+    long tail = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char *a = argv[i], *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--bucket") && v) {
+            bucket_ns = !strcmp(v, "hour") ? 60 * NS_PER_MIN
+                      : !strcmp(v, "day")  ? 24 * 60 * NS_PER_MIN
+                      : atol(v) * NS_PER_MIN;
+            i++;
+        } else if (!strcmp(a, "--tail") && v) {
+            tail = atol(v);
+            i++;
+        } else if (a[0] != '-' && !path) {
+            path = a;
+        } else {
+            fprintf(stderr, "usage: %s [FILE] [--bucket hour|day|MINUTES] [--tail N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (bucket_ns <= 0) bucket_ns = 60 * NS_PER_MIN;
+
+    journal_t j;
+    if (journal_open_ro(&j, path) != 0) return 1;
+
+    uint64_t first, next;
+    journal_range(&j, &first, &next);
+    size_t cap = (size_t)(next - first);
+    journal_rec_t *recs = malloc(sizeof(*recs) * (cap ? cap : 1));
+    int64_t *item = malloc(sizeof(int64_t) * (cap ? cap : 1));
+    int64_t *host = malloc(sizeof(int64_t) * (cap ? cap : 1));
+    if (!recs || !item || !host) {
+        perror("journal_read");
+        return 1;
+    }
+
+    size_t n = 0, torn = 0;
+    for (uint64_t seq = first; seq < next; ++seq) {
+        if (journal_read(&j, seq, &recs[n])) n++;
+        else torn++;                 // overwritten meanwhile, or a crash mid-write
+    }
+
+    char created[32];
+    fmt_wall(j.hdr->created_wall, created, sizeof(created));
+    printf("journal: %llu slots, %zu records (seq %llu..%llu), %u runs, created %s",
+           (unsigned long long)j.capacity, n, (unsigned long long)first,
+           (unsigned long long)(next - 1), j.boot, created);
+    if (torn) printf(", %zu unreadable", torn);
+    printf("\n");
+    if (n == 0) {
+        journal_close(&j);
+        return 0;
+    }
+
+    // runs restart now_ns(), but wall time orders everything
+    qsort(recs, n, sizeof(recs[0]), cmp_wall);
+
+    printf("\n%-17s %7s %8s %9s %8s %6s %8s %6s %6s\n", "from", "items", "rejected",
+           "items/min", "item p50", "p95", "host p50", "p95", "early");
+    size_t start = 0;
+    for (size_t i = 1; i <= n; ++i) {
+        if (i == n || recs[i].t_wall / bucket_ns != recs[start].t_wall / bucket_ns) {
+            print_bucket(NULL, &recs[start], i - start, item, host);
+            start = i;
+        }
+    }
+    print_bucket("all", recs, n, item, host);
+
+    if (tail > 0) {
+        printf("\n%8s %-17s %6s %4s %6s %5s %4s %9s %9s\n", "seq", "time", "job", "cls",
+               "conf", "run", "host", "host ms", "item ms");
+        for (size_t i = (n > (size_t)tail) ? n - (size_t)tail : 0; i < n; ++i) {
+            const journal_rec_t *r = &recs[i];
+            char when[32];
+            fmt_wall(r->t_wall, when, sizeof(when));
+            printf("%8llu %-17s %6u %4d %5.1f%% %5u %4d %9.0f %9.0f%s\n",
+                   (unsigned long long)r->seq, when, r->job_id, r->cls, r->conf / 10.0,
+                   r->boot, r->host, (double)(r->t_result - r->t_sent) / NS_PER_MS,
+                   (double)(r->t_done - r->t_press) / NS_PER_MS,
+                   r->outcome == JOURNAL_REJECTED ? "  rejected" : "");
+        }
+    }
+
+    free(recs);
+    free(item);
+    free(host);
+    journal_close(&j);
+    return 0;
+}
@@ -0,0 +1,133 @@
+// tools/quad_bench.c
+// Throughput check for the LUT quadrature decoder (hal/quad_decoder.h).
+//
+// Builds synthetic AB sequences (a random walk at one count per poll,
+// with direction changes and injected missed samples), decodes them, and
+// checks per case that:
+//  - every injected skip is reported as an error,
+//  - the velocity-based correction rebuilds the exact true position,
+//  - throughput is far above anything a physical encoder can produce.
+// The cases: 2-count bursts within one poll, late polls that miss
+// 2 + 4k counts at the same speed, and frequent reversals.
+//
+// usage: quad_bench [transitions] [skip_every]
+
+#include "quad_decoder.h"
+#include "timebase.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Gray order for +1 steps: 00 -> 01 -> 11 -> 10
+static const unsigned k_gray[4] = { 0, 1, 3, 2 };
+
+#define BENCH_COUNTS_PER_REV  80        // 20-detent encoder, 4 edges/detent
+#define BENCH_PHYS_MAX_RPM    10000.0   // far beyond any hand/conveyor knob
+#define BENCH_MARGIN          1000.0    // required headroom over that
+#define BENCH_ROUNDS          5
+#define BENCH_POLL_NS         NS_PER_MS
+
+// xorshift: fast and reproducible
+static uint32_t rng_next(uint32_t *s)
+{
+    uint32_t x = *s;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return *s = x;
+}
+
+typedef struct {
+    const char *name;
+    long        skip_every;   // 0 = none
+    int         max_k;        // a skip misses 2 + 4k counts, k <= max_k
+    bool        late;         // the skip is a late poll (same speed), not a burst
+    uint32_t    rev_mask;     // reverse when (rng & mask) == 0
+} case_t;
+
+static int run(const case_t *c, long n)
+{
+    uint8_t *seq = malloc((size_t)n);
+    uint8_t *gap = malloc((size_t)n);     // polls since the previous sample
+    if (!seq || !gap) { perror("malloc"); free(seq); free(gap); return 0; }
+
+    // ---- build the sequence ----------------------------------------------
+    uint32_t rng = 0x12345678u;
+    int phase = 0, dir = 1, prev_dir = 0;
+    long true_pos = 0, injected = 0;
+    for (long i = 0; i < n; ++i) {
+        if ((rng_next(&rng) & c->rev_mask) == 0) dir = -dir;
+
+        // a skip only where the decoder can know the direction: previous
+        // sample was a step the same way
+        int skip = (c->skip_every > 0 && i % c->skip_every == c->skip_every - 1 &&
+                    prev_dir == dir);
+        int len  = skip ? 2 + 4 * (int)(rng_next(&rng) % (uint32_t)(c->max_k + 1)) : 1;
+        int step = len * dir;
+
+        phase = (phase + step + 4) & 3;
+        true_pos += step;
+        injected += skip;
+        prev_dir  = skip ? 0 : dir;      // don't put two skips back to back
+        seq[i] = (uint8_t)k_gray[phase];
+        gap[i] = (uint8_t)(skip && c->late ? len : 1);
+    }
+
+    // ---- decode, best of a few rounds ------------------------------------
+    quad_decoder_t q;
+    nsec_t best = -1;
+    for (int r = 0; r < BENCH_ROUNDS; ++r) {
+        nsec_t t = 0;
+        quad_decoder_init(&q, k_gray[0], t);
+        nsec_t t0 = now_ns();
+        for (long i = 0; i < n; ++i) {
+            t += gap[i] * BENCH_POLL_NS;
+            quad_decoder_step(&q, seq[i], t);
+        }
+        nsec_t dt = ns_since(t0);
+        if (best < 0 || dt < best) best = dt;
+    }
+    free(seq);
+    free(gap);
+
+    double per_sec = (double)n * 1e9 / (double)best;
+    double max_rpm = per_sec * 60.0 / BENCH_COUNTS_PER_REV;
+    double need    = BENCH_PHYS_MAX_RPM * BENCH_COUNTS_PER_REV / 60.0 * BENCH_MARGIN;
+
+    printf("%s\n", c->name);
+    printf("  transitions     : %ld (%ld skips injected)\n", n, injected);
+    printf("  decode time     : %.3f ms (best of %d)\n", best / 1e6, BENCH_ROUNDS);
+    printf("  throughput      : %.1f M transitions/s (%.2f ns each)\n",
+           per_sec / 1e6, (double)best / (double)n);
+    printf("  equivalent speed: %.0f RPM at %d counts/rev\n", max_rpm, BENCH_COUNTS_PER_REV);
+    printf("  errors detected : %u\n", q.errors);
+    printf("  position        : decoded %d, true %ld (lost-count estimate %d)\n",
+           q.pos, true_pos, q.lost_est);
+
+    int ok = 1;
+    if ((long)q.errors != injected) { printf("  FAIL: error count mismatch\n"); ok = 0; }
+    if ((long)q.pos != true_pos)    { printf("  FAIL: position mismatch\n");    ok = 0; }
+    if (per_sec < need) {
+        printf("  FAIL: %.0f transitions/s is under %.0fx a %.0f RPM encoder\n",
+               per_sec, BENCH_MARGIN, BENCH_PHYS_MAX_RPM);
+        ok = 0;
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    long n = (argc > 1) ? atol(argv[1]) : 10000000L;
+    long skip_every = (argc > 2) ? atol(argv[2]) : 1000;
+    if (n < 1000) n = 1000;
+
+    const case_t cases[] = {
+        { "2-count bursts",       skip_every, 0, false, 0xFF },
+        { "late polls (2+4k)",    skip_every, 2, true,  0xFF },
+        { "reversals every ~8",   skip_every, 2, true,  0x07 },
+    };
+    int ok = 1;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+        ok &= run(&cases[i], n);
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
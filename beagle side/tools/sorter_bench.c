@@ -0,0 +1,534 @@
+// tools/sorter_bench.c
+// End-to-end throughput of the sorting line, for sizing camera/model changes.
+//
+// Runs the real loop from app/src/sorter.c in-process. The servo and
+// encoder drivers are replaced by the stubs below (link-time, so sorter.c
+// is byte-for-byte what ships) and host_main_server.py by a loopback UDP
+// thread that injects capture, inference and network delays. Built with
+// TIMEBASE_SIM: every sleep is virtual, so hours of line time take seconds.
+//
+// usage: sorter_bench [-n items] [--arrival D] [--capture D] [--inference D]
+//                     [--network D] [--hosts N] [--stall P:D] [--hedge-ms N]
+//                     [--frames N] [--frame-acc P] [--min-conf N]
+//                     [--classes FILE] [--journal FILE] [--hold-ms N]
+//                     [--seed N] [-v]
+//   D (milliseconds) = const:X | uniform:LO:HI | normal:MEAN:SD | exp:MEAN
+//   --arrival is the gap between items reaching the station; const:0
+//   (default) keeps the line saturated.
+//   --hosts runs N stand-in hosts (hedging goes down the list); --stall
+//   makes each host, with probability P per job, stall for an extra D.
+//   --frames streams N per-photo predictions (0 = only the final result),
+//   each right with probability --frame-acc; --inference is split over them.
+//   Wrong frames tend to be less confident, so --min-conf (per mille,
+//   every class) trades rejects against missorts. --classes loads a class
+//   table (see class_table.h); items are spread evenly over its classes.
+//   --journal records every item like the app does (tools/journal_read);
+//   wall times are virtual too, so a long run fills days of history.
+
+#include "sorter.h"
+#include "sort_proto.h"
+#include "rotary.h"
+#include "servo.h"
+#include "timebase.h"
+#include "evlog.h"
+
+#include <arpa/inet.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define BENCH_HOST_PORT     16000     // not 6000/5005: a real host may be up
+#define BENCH_LISTEN_PORT   16005
+#define BENCH_HOST_POLL_NS  (1 * NS_PER_MS)
+#define BENCH_HOST_OFFSET_NS (1234 * NS_PER_SEC + 567 * NS_PER_US)
+
+typedef struct {
+    char   kind;       // 'c'onst, 'u'niform, 'n'ormal, 'e'xp
+    double a, b;       // ms
+} dist_t;
+
+// xorshift: fast and reproducible
+static uint32_t rng_next(uint32_t *s)
+{
+    uint32_t x = *s;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return *s = x;
+}
+
+static double rng_unit(uint32_t *s)      // (0, 1)
+{
+    return ((double)rng_next(s) + 0.5) / 4294967296.0;
+}
+
+static nsec_t dist_sample(const dist_t *d, uint32_t *rng)
+{
+    double ms = d->a;
+    switch (d->kind) {
+    case 'u': ms = d->a + (d->b - d->a) * rng_unit(rng); break;
+    case 'n': ms = d->a + d->b * sqrt(-2.0 * log(rng_unit(rng))) * cos(2.0 * M_PI * rng_unit(rng)); break;
+    case 'e': ms = -d->a * log(rng_unit(rng)); break;
+    default:  break;
+    }
+    return (ms > 0) ? (nsec_t)(ms * NS_PER_MS) : 0;
+}
+
+static int dist_parse(const char *s, dist_t *d)
+{
+    d->a = d->b = 0;
+    if (sscanf(s, "const:%lf", &d->a) == 1)               { d->kind = 'c'; return 0; }
+    if (sscanf(s, "uniform:%lf:%lf", &d->a, &d->b) == 2)  { d->kind = 'u'; return 0; }
+    if (sscanf(s, "normal:%lf:%lf", &d->a, &d->b) == 2)   { d->kind = 'n'; return 0; }
+    if (sscanf(s, "exp:%lf", &d->a) == 1)                 { d->kind = 'e'; return 0; }
+    fprintf(stderr, "bad distribution '%s'\n", s);
+    return -1;
+}
+
+// ---------- bench state ----------
+static int       g_items = 200;
+static nsec_t   *g_arrive;            // when item i reaches the station
+static int       g_next;              // next item to be "pressed"
+static const sorter_t *g_sorter;      // the operator only clicks when it is free
+static atomic_int g_stop;
+static atomic_int g_hosts_up;         // host threads attached to the clock
+static unsigned long long g_servo_writes;
+static unsigned long long g_missorted, g_rejected, g_rejected_wrong;
+
+static int g_ids[CLASS_MAX];           // class ids an item can be
+static int g_n_ids;
+
+// what item job_id really is; every host agrees, whoever gets asked
+static int item_truth(uint32_t job_id)
+{
+    uint32_t x = job_id * 2654435761u;
+    return g_ids[(x >> 16) % (uint32_t)g_n_ids];
+}
+
+// what a misclassification says instead
+static int item_wrong(int truth, uint32_t *rng)
+{
+    int i = 0;
+    while (g_ids[i] != truth) ++i;
+    return g_ids[(i + 1 + rng_next(rng) % (uint32_t)(g_n_ids - 1)) % (uint32_t)g_n_ids];
+}
+
+typedef struct {
+    nsec_t *queue;       // arrival -> button
+    nsec_t *host;        // start sent -> result received
+    nsec_t *item;        // arrival -> back at neutral
+    int     n;
+    nsec_t  last_done;
+} results_t;
+
+// ---------- stub drivers (link-time replacements for hal/src) ----------
+// an item at a free station gets its button pressed (what the sorter
+// starts a job from by default)
+bool rotaryEncoder_next_event(rotary_event_t *ev)
+{
+    if (sorter_busy(g_sorter) || g_sorter->trigger) return false;
+    if (g_next >= g_items || g_arrive[g_next] > now_ns()) return false;
+    nsec_t t = now_ns();
+    *ev = (rotary_event_t){ .type = ROTARY_EV_PRESS, .t_ns = t, .t_down_ns = t };
+    g_next++;
+    return true;
+}
+
+const char *rotaryEncoder_event_name(rotary_event_type_t t)
+{
+    (void)t;
+    return "?";
+}
+
+// the real driver lands the write just after the next PWM period boundary
+int servo_set_pulse_aligned(Servo *s, int duty_ns)
+{
+    (void)s;
+    (void)duty_ns;
+    const nsec_t period = 20 * NS_PER_MS;
+    sleep_until_ns((now_ns() / period + 1) * period);
+    g_servo_writes++;
+    return 0;
+}
+
+int servo_rearm(Servo *s) { (void)s; return 0; }
+int servo_idle(Servo *s)  { (void)s; return 0; }
+
+// ---------- loopback host ----------
+typedef struct {
+    dist_t   capture, inference, network, stall;
+    double   stall_p;    // chance a job hits a stall
+    int      frames;     // SP_FRAMEs per job, 0 = SP_RESULT only
+    double   frame_acc;  // chance a frame has the right class
+    uint32_t seed;
+    int      sock;       // bound before the sorter sends its first "start"
+} host_cfg_t;
+
+static int host_bind(int port)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in me = { .sin_family = AF_INET, .sin_port = htons(port) };
+    me.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (sock < 0 || bind(sock, (struct sockaddr *)&me, sizeof(me)) < 0) {
+        perror("sorter_bench: host bind");
+        if (sock >= 0) close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// the host's clock is deliberately far from ours so the offset estimate
+// has something to find
+static nsec_t host_now(void)
+{
+    return now_ns() + BENCH_HOST_OFFSET_NS;
+}
+
+// One job at a time, run as a small state machine so pings are answered
+// immediately even while a job is "capturing" or "classifying".
+static void *host_thread(void *arg)
+{
+    host_cfg_t *h = arg;
+    uint32_t rng = h->seed ? h->seed : 1;
+    int sock = h->sock;
+    timebase_thread_attach();
+    atomic_fetch_add(&g_hosts_up, 1);
+
+    enum { IDLE, NET_IN, CAPTURE, INFER, NET_BACK } stage = IDLE;
+    nsec_t due = 0, per_frame = 0;
+    sp_timing_t tm;
+    sp_result_t res;
+    sp_frame_t fr;
+    int truth = SORT_PAPER, wrong = SORT_PLASTIC, right = 0;
+    unsigned conf_right = 0, conf_wrong = 0;
+    struct sockaddr_in peer;
+    socklen_t plen = sizeof(peer);
+
+    while (!atomic_load(&g_stop)) {
+        char buf[64];
+        struct sockaddr_in from;
+        socklen_t flen = sizeof(from);
+        ssize_t n;
+        while ((n = recvfrom(sock, buf, sizeof(buf), MSG_DONTWAIT,
+                             (struct sockaddr *)&from, &flen)) > 0) {
+            nsec_t t_rx = host_now();
+            const sp_hdr_t *hdr = sp_parse(buf, (unsigned long)n);
+            if (!hdr) continue;
+
+            if (hdr->type == SP_PING && n >= (ssize_t)sizeof(sp_ping_t)) {
+                sp_ping_t pong = *(const sp_ping_t *)hdr;
+                pong.h.type = SP_PONG;
+                pong.t2 = t_rx;
+                pong.t3 = host_now();
+                sendto(sock, &pong, sizeof(pong), 0, (struct sockaddr *)&from, flen);
+            } else if (hdr->type == SP_START && stage == IDLE &&
+                       n >= (ssize_t)sizeof(sp_start_t)) {
+                memset(&res, 0, sizeof(res));
+                res.h       = sp_hdr(SP_RESULT, hdr->job_id);
+                res.host_id = ((const sp_start_t *)hdr)->host_id;
+                memset(&fr, 0, sizeof(fr));
+                fr.h        = sp_hdr(SP_FRAME, hdr->job_id);
+                fr.host_id  = res.host_id;
+                fr.n_frames = (uint8_t)h->frames;
+                truth = item_truth(hdr->job_id);
+                right = 0;
+                conf_right = conf_wrong = 0;
+                memset(&tm, 0, sizeof(tm));
+                tm.h  = sp_hdr(SP_TIMING, hdr->job_id);
+                peer  = from;
+                plen  = flen;
+                stage = NET_IN;
+                due   = now_ns() + dist_sample(&h->network, &rng);
+            }
+            // a START while busy is dropped, like host_main_server.py
+            flen = sizeof(from);
+        }
+
+        // network in, photos, model, network back
+        while (stage != IDLE && now_ns() >= due) {
+            switch (stage) {
+            case NET_IN:
+                tm.t_rx = host_now();
+                stage = CAPTURE;  due += dist_sample(&h->capture, &rng);
+                break;
+            case CAPTURE:
+                tm.t_captured = host_now();
+                per_frame = dist_sample(&h->inference, &rng) / (h->frames ? h->frames : 1);
+                stage = INFER;    due += per_frame;
+                if (rng_unit(&rng) < h->stall_p)
+                    due += dist_sample(&h->stall, &rng);   // slow box, GC, swap...
+                break;
+            case INFER:
+                if (fr.frame < fr.n_frames) {
+                    // one photo classified: stream it (the network delay is
+                    // only modelled on the final result)
+                    bool ok = rng_unit(&rng) < h->frame_acc;
+                    right  += ok;
+                    fr.cls  = (uint8_t)(ok ? truth : item_wrong(truth, &rng));
+                    if (!ok) wrong = fr.cls;
+                    fr.conf = (uint16_t)(ok ? 650 + rng_next(&rng) % 350
+                                            : 500 + rng_next(&rng) % 300);
+                    if (ok) conf_right += fr.conf; else conf_wrong += fr.conf;
+                    fr.t_sent = host_now();
+                    sendto(sock, &fr, sizeof(fr), 0, (struct sockaddr *)&peer, plen);
+                    if (++fr.frame < fr.n_frames) { due += per_frame; break; }
+                }
+                tm.t_classified = host_now();
+                stage = NET_BACK; due += dist_sample(&h->network, &rng);
+                break;
+            default: {
+                // the host's own best-of-N (no frames: always right)
+                bool ok = !h->frames || 2 * right > h->frames;
+                res.cls = (uint8_t)(ok ? truth : wrong);
+                if (h->frames)     // mean over the frames that voted for it
+                    res.conf = (uint16_t)(ok ? conf_right / (unsigned)right
+                                             : conf_wrong / (unsigned)(h->frames - right));
+                sendto(sock, &res, sizeof(res), 0, (struct sockaddr *)&peer, plen);
+                sendto(sock, &tm, sizeof(tm), 0, (struct sockaddr *)&peer, plen);
+                stage = IDLE;
+                break;
+            }
+            }
+        }
+
+        nsec_t next = now_ns() + BENCH_HOST_POLL_NS;
+        sleep_until_ns((stage != IDLE && due < next) ? due : next);
+    }
+
+    close(sock);
+    timebase_thread_detach();
+    return NULL;
+}
+
+// ---------- results ----------
+static void on_job(const sorter_job_t *job, void *ctx)
+{
+    results_t *r = ctx;
+    nsec_t arrive = g_arrive[r->n];      // items are served in arrival order
+    r->queue[r->n] = job->t_press - arrive;
+    r->host[r->n]  = job->t_result - job->t_sent;
+    r->item[r->n]  = job->t_done - arrive;
+    r->last_done   = job->t_done;
+    bool wrong = (int)job->cls != item_truth(job->id);
+    if (job->rejected) {
+        g_rejected++;
+        g_rejected_wrong += wrong;
+    } else if (wrong) {
+        g_missorted++;
+    }
+    if (++r->n >= g_items) atomic_store(&g_stop, 1);
+}
+
+static int cmp_ns(const void *a, const void *b)
+{
+    nsec_t x = *(const nsec_t *)a, y = *(const nsec_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_pcts(const char *name, nsec_t *v, int n)
+{
+    qsort(v, (size_t)n, sizeof(v[0]), cmp_ns);
+    printf("  %-22s p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f ms\n", name,
+           v[n / 2] / 1e6, v[(n * 90) / 100] / 1e6, v[(n * 99) / 100] / 1e6, v[n - 1] / 1e6);
+}
+
+static nsec_t real_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ns_from_timespec(&t);
+}
+
+int main(int argc, char **argv)
+{
+    host_cfg_t host = { .seed = 351, .frames = 3, .frame_acc = 0.9 };
+    dist_t arrival;
+    dist_parse("const:0", &arrival);
+    dist_parse("uniform:300:500", &host.capture);     // three photos
+    dist_parse("normal:800:150", &host.inference);
+    dist_parse("exp:2", &host.network);
+    dist_parse("const:0", &host.stall);
+    long hold_ms = -1, hedge_ms = -1, min_conf = -1;
+    const char *classes = NULL, *journal = NULL;
+    int n_hosts = 1;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const char *a = argv[i], *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        int bad = 0;
+        if      (!strcmp(a, "-v"))                       { verbose = true; continue; }
+        else if (!v)                                     bad = 1;
+        else if (!strcmp(a, "-n"))                       g_items = atoi(v);
+        else if (!strcmp(a, "--arrival"))                bad = dist_parse(v, &arrival);
+        else if (!strcmp(a, "--capture"))                bad = dist_parse(v, &host.capture);
+        else if (!strcmp(a, "--inference"))              bad = dist_parse(v, &host.inference);
+        else if (!strcmp(a, "--network"))                bad = dist_parse(v, &host.network);
+        else if (!strcmp(a, "--hosts"))                  n_hosts = atoi(v);
+        else if (!strcmp(a, "--stall"))                  bad = (sscanf(v, "%lf:", &host.stall_p) != 1 ||
+                                                               !strchr(v, ':') ||
+                                                               dist_parse(strchr(v, ':') + 1, &host.stall));
+        else if (!strcmp(a, "--hedge-ms"))               hedge_ms = atol(v);
+        else if (!strcmp(a, "--frames"))                 host.frames = atoi(v);
+        else if (!strcmp(a, "--frame-acc"))              host.frame_acc = atof(v);
+        else if (!strcmp(a, "--min-conf"))               min_conf = atol(v);
+        else if (!strcmp(a, "--classes"))                classes = v;
+        else if (!strcmp(a, "--journal"))                journal = v;
+        else if (!strcmp(a, "--hold-ms"))                hold_ms = atol(v);
+        else if (!strcmp(a, "--seed"))                   host.seed = (uint32_t)strtoul(v, NULL, 0);
+        else                                             bad = 1;
+        if (bad) {
+            fprintf(stderr, "usage: %s [-n items] [--arrival D] [--capture D] [--inference D]\n"
+                            "       [--network D] [--hosts N] [--stall P:D] [--hedge-ms N]\n"
+                            "       [--frames N] [--frame-acc P] [--min-conf N]\n"
+                            "       [--classes FILE] [--journal FILE] [--hold-ms N]\n"
+                            "       [--seed N] [-v]\n"
+                            "  D = const:MS | uniform:LO:HI | normal:MEAN:SD | exp:MEAN\n", argv[0]);
+            return 2;
+        }
+        i++;
+    }
+    if (g_items < 1) g_items = 1;
+    if (n_hosts < 1) n_hosts = 1;
+    if (n_hosts > SORTER_MAX_HOSTS) n_hosts = SORTER_MAX_HOSTS;
+    if (host.frames < 0) host.frames = 0;
+    if (host.frames > SORTER_MAX_FRAMES) host.frames = SORTER_MAX_FRAMES;
+
+    timebase_init(NULL);                     // this thread drives virtual time
+    FILE *log = verbose ? stdout : fopen("/dev/null", "w");
+    evlog_start(log, true);
+
+    // arrival schedule
+    uint32_t rng = host.seed ^ 0x9e3779b9u;
+    g_arrive = malloc(sizeof(nsec_t) * (size_t)g_items);
+    results_t res = {
+        .queue = malloc(sizeof(nsec_t) * (size_t)g_items),
+        .host  = malloc(sizeof(nsec_t) * (size_t)g_items),
+        .item  = malloc(sizeof(nsec_t) * (size_t)g_items),
+    };
+    if (!g_arrive || !res.queue || !res.host || !res.item) return 1;
+    nsec_t t = now_ns();
+    for (int i = 0; i < g_items; ++i) {
+        g_arrive[i] = t;
+        t += dist_sample(&arrival, &rng);
+    }
+
+    sorter_config_t cfg;
+    sorter_config_default(&cfg);
+    cfg.n_hosts = n_hosts;
+    for (int h = 0; h < n_hosts; ++h) {
+        snprintf(cfg.hosts[h].ip, sizeof(cfg.hosts[h].ip), "127.0.0.1");
+        cfg.hosts[h].port = BENCH_HOST_PORT + h;
+    }
+    cfg.listen_port = BENCH_LISTEN_PORT;
+    if (classes && class_table_load(&cfg.classes, classes) != 0) return 1;
+    if (hedge_ms >= 0) cfg.hedge_ns = hedge_ms * NS_PER_MS;
+    for (int c = 0; c < CLASS_MAX; ++c) {
+        class_entry_t *e = &cfg.classes.by_id[c];
+        if (!e->used) continue;
+        for (int i = 0; hold_ms >= 0 && i < e->n_targets; ++i)   // split over the targets
+            e->targets[i].hold_ns = hold_ms * NS_PER_MS / e->n_targets;
+        if (c != SORT_NONE && min_conf >= 0) e->min_conf = (int)min_conf;
+        if (c != SORT_NONE) g_ids[g_n_ids++] = c;
+    }
+    if (g_n_ids < 2) {
+        fprintf(stderr, "sorter_bench: need at least two classes\n");
+        return 1;
+    }
+
+    Servo servo;
+    memset(&servo, 0, sizeof(servo));
+    sorter_t sorter;
+    if (sorter_init(&sorter, &cfg, &servo) != 0) return 1;
+    g_sorter = &sorter;
+    sorter_on_job(&sorter, on_job, &res);
+    journal_t jnl;
+    if (journal) {
+        if (journal_open(&jnl, journal, 0) != 0) return 1;
+        sorter_set_journal(&sorter, &jnl);
+    }
+
+    host_cfg_t hosts[SORTER_MAX_HOSTS];
+    pthread_t th[SORTER_MAX_HOSTS];
+    for (int h = 0; h < n_hosts; ++h) {
+        hosts[h] = host;
+        hosts[h].seed = host.seed + 7919u * (uint32_t)h;
+        hosts[h].sock = host_bind(BENCH_HOST_PORT + h);
+        if (hosts[h].sock < 0) return 1;
+    }
+    for (int h = 0; h < n_hosts; ++h)
+        pthread_create(&th[h], NULL, host_thread, &hosts[h]);
+    // until they have attached, virtual time would run ahead without them
+    while (atomic_load(&g_hosts_up) < n_hosts)
+        sched_yield();
+
+    nsec_t v0 = now_ns(), r0 = real_ns();
+    while (!atomic_load(&g_stop)) {
+        sorter_step(&sorter);
+        sleep_ns(cfg.loop_ns);
+    }
+    nsec_t r1 = real_ns();
+
+    timebase_thread_detach();                // let the host threads finish on their own
+    for (int h = 0; h < n_hosts; ++h)
+        pthread_join(th[h], NULL);
+    sorter_close(&sorter);
+    if (journal) journal_close(&jnl);
+    evlog_stop();
+
+    if (res.n == 0) {
+        fprintf(stderr, "sorter_bench: no items completed\n");
+        return 1;
+    }
+    double span_s = (double)(res.last_done - v0) / 1e9;
+    printf("sorter_bench: %d items, %d classes, %llu servo writes, %llu unknown msgs\n",
+           res.n, g_n_ids, g_servo_writes, sorter.unknown);
+    printf("  throughput             %.1f items/min (%.1f s of line time)\n",
+           res.n * 60.0 / span_s, span_s);
+    udp_rx_stats_t rx;
+    udp_rx_get_stats(&sorter.rx, &rx);
+    printf("  result port            %llu datagrams, %llu batches (max %llu), %llu kernel drops\n",
+           rx.datagrams, rx.calls, rx.max_batch, rx.kernel_drops);
+    sorter_split_t sp;
+    sorter_get_split(&sorter, &sp);
+    for (int h = 0; h < n_hosts; ++h) {
+        const clock_sync_t *cs = &sorter.hosts[h].sync;
+        sorter_host_stats_t hs;
+        sorter_get_host_stats(&sorter, h, &hs);
+        printf("  host %d                 %llu starts (%llu hedges), %llu wins, %llu late; "
+               "p50 %.0f p95 %.0f p99 %.0f max %.0f ms\n", h,
+               hs.starts, hs.hedges, hs.wins, hs.late,
+               hs.p50_ns / 1e6, hs.p95_ns / 1e6, hs.p99_ns / 1e6, hs.max_ns / 1e6);
+        printf("                         clock offset %+.3f ms off the truth, rtt %.3f ms, %llu pongs\n",
+               (cs->offset_ns - BENCH_HOST_OFFSET_NS) / 1e6, cs->rtt_ns / 1e6, cs->samples);
+    }
+    printf("  routing                %llu missorted, %llu rejected (%llu of them would have "
+           "been wrong)\n", g_missorted, g_rejected, g_rejected_wrong);
+    if (host.frames) {
+        printf("  streamed frames        %llu of %d items decided early, %llu late frames/results "
+               "(%llu disagreed)\n", sorter.early, res.n, sorter.late_frames, sorter.late_disagree);
+    }
+    if (n_hosts > 1)
+        printf("  hedge delay            %.0f ms at the end of the run\n", sorter_hedge_delay(&sorter) / 1e6);
+    if (sp.count) {
+        printf("  mean split (%llu items)  net out %.1f, capture %.1f, inference %.1f, "
+               "net back %.1f, actuation %.1f ms\n", sp.count,
+               sp.net_out / 1e6, sp.capture / 1e6, sp.inference / 1e6,
+               sp.net_back / 1e6, sp.actuation / 1e6);
+    }
+    if (sorter.timing_skewed)
+        printf("                         %llu items left out: legs off by more than rtt/2\n",
+               sorter.timing_skewed);
+    print_pcts("queueing delay", res.queue, res.n);
+    print_pcts("host round trip", res.host, res.n);
+    print_pcts("item latency", res.item, res.n);
+    printf("  simulated in %.2f s real (%.0fx)\n", (r1 - r0) / 1e9, span_s * 1e9 / (double)(r1 - r0));
+
+    free(g_arrive);
+    free(res.queue); free(res.host); free(res.item);
+    return 0;
+}
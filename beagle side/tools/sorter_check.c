@@ -0,0 +1,305 @@
+// tools/sorter_check.c
+// Scripted inputs for the sorter's pure parts, checked against what has
+// to come out:
+//   vote     streamed-frame voting: when a job may be decided early
+//   clock    the ping/pong clock filter (clock_sync.h)
+//   classes  class table files, good and broken (class_table.h)
+//   journal  reopening the ring after torn writes (journal.h)
+// usage: sorter_check [vote|clock|classes|journal]   (none = all)
+
+#include "class_table.h"
+#include "clock_sync.h"
+#include "journal.h"
+#include "sorter.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int g_pass, g_run;
+
+static void report(const char *group, const char *name, int ok)
+{
+    char tag[16];
+    snprintf(tag, sizeof(tag), "[%s]", group);
+    printf("%-10s%-34s %s\n", tag, name, ok ? "ok" : "FAIL");
+    g_pass += ok;
+    g_run++;
+}
+
+// ---------- vote ----------
+// A script is a string of frames, one character each: a digit is a class
+// id, '-' no idea. 'expect' is what the vote says after each frame
+// ('.' = undecided), so "..1" decides paper on the third frame.
+typedef struct {
+    const char *name;
+    int         n_frames;
+    const char *frames;
+    const char *conf;       // per frame, '0'..'9' -> 0..900 per mille; NULL = 700
+    const char *expect;
+} vote_case_t;
+
+static void check_vote(void)
+{
+    static const vote_case_t cases[] = {
+        { "2 of 3 agree: early",     3, "11",    NULL,    ".1" },
+        { "split, last decides",     3, "121",   NULL,    "..1" },
+        { "leader can still be caught", 4, "112", NULL,   "..." },
+        { "no idea never decides",   3, "---",   NULL,    "..." },
+        { "no idea, then a clear leader", 4, "1-1", NULL, "..1" },
+        { "tie goes to confidence",  2, "12",    "59",    ".2" },
+        { "single frame",            1, "2",     NULL,    "2" },
+        { "tie, same confidence: lower id", 5, "1212-", NULL, "....1" },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        const vote_case_t *c = &cases[i];
+        sorter_vote_t v;
+        memset(&v, 0, sizeof(v));
+        char got[SORTER_MAX_FRAMES + 1] = { 0 };
+        for (int f = 0; c->frames[f]; ++f) {
+            sort_class_t cls = c->frames[f] == '-' ? SORT_NONE : c->frames[f] - '0';
+            unsigned conf = c->conf ? (unsigned)(c->conf[f] - '0') * 100 : 700;
+            sorter_vote_add(&v, f, c->n_frames, cls, conf);
+            sort_class_t out = sorter_vote_outcome(&v);
+            got[f] = out == SORT_NONE ? '.' : (char)('0' + out);
+        }
+        int ok = strcmp(got, c->expect) == 0;
+        report("vote", c->name, ok);
+        if (!ok) printf("       expected %s, got %s\n", c->expect, got);
+    }
+
+    // a repeated frame index is not a second vote
+    sorter_vote_t v;
+    memset(&v, 0, sizeof(v));
+    int ok = sorter_vote_add(&v, 0, 3, SORT_PAPER, 700) &&
+             !sorter_vote_add(&v, 0, 3, SORT_PAPER, 700) &&
+             v.seen == 1 && sorter_vote_outcome(&v) == SORT_NONE;
+    report("vote", "duplicate frame ignored", ok);
+}
+
+// ---------- clock ----------
+#define HOST_OFF  (5 * NS_PER_SEC)
+
+// One exchange: out / back are the one-way delays, turn the host's
+// time between receiving and answering.
+static void exchange(clock_sync_t *cs, nsec_t t1, nsec_t out, nsec_t turn, nsec_t back,
+                     nsec_t host_off)
+{
+    nsec_t t2 = t1 + out + host_off;
+    clock_sync_add(cs, t1, t2, t2 + turn, t1 + out + turn + back);
+}
+
+static void check_clock(void)
+{
+    clock_sync_t cs;
+    clock_sync_init(&cs);
+    report("clock", "empty filter is not valid", !clock_sync_valid(&cs));
+
+    exchange(&cs, 0, NS_PER_MS, 200 * NS_PER_US, NS_PER_MS, HOST_OFF);
+    report("clock", "symmetric: exact offset and rtt",
+           clock_sync_valid(&cs) && cs.offset_ns == HOST_OFF && cs.rtt_ns == 2 * NS_PER_MS);
+
+    // queued on the way out: a bigger RTT and an offset 4.5 ms off
+    exchange(&cs, 10 * NS_PER_MS, 10 * NS_PER_MS, 0, NS_PER_MS, HOST_OFF);
+    report("clock", "queued sample doesn't move it",
+           cs.offset_ns == HOST_OFF && cs.rtt_ns == 2 * NS_PER_MS &&
+           cs.rtt_last_ns == 11 * NS_PER_MS);
+
+    // host stamps from before we sent: negative RTT
+    clock_sync_add(&cs, 30 * NS_PER_MS, HOST_OFF, HOST_OFF + 50 * NS_PER_MS, 31 * NS_PER_MS);
+    report("clock", "negative rtt rejected",
+           cs.rejected == 1 && cs.samples == 2 && cs.offset_ns == HOST_OFF);
+
+    // the host's clock moved; after a window of samples the old best is gone
+    for (int i = 0; i < CLOCK_SYNC_WINDOW; ++i)
+        exchange(&cs, (40 + i) * NS_PER_MS, 1500 * NS_PER_US, 0, 1500 * NS_PER_US,
+                 HOST_OFF + 100 * NS_PER_US);
+    report("clock", "old best ages out of the window",
+           cs.offset_ns == HOST_OFF + 100 * NS_PER_US && cs.rtt_ns == 3 * NS_PER_MS &&
+           cs.rtt_min_ns == 2 * NS_PER_MS);
+
+    report("clock", "host time to ours",
+           clock_sync_to_local(&cs, HOST_OFF + 100 * NS_PER_US + 7) == 7);
+}
+
+// ---------- classes ----------
+// Writes text to a temporary file and loads it over the default table.
+static int load_text(class_table_t *t, const char *text)
+{
+    char path[] = "/tmp/sorter_check.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) { perror("mkstemp"); return -2; }
+    ssize_t len = (ssize_t)strlen(text);
+    int rc = write(fd, text, (size_t)len) == len ? 0 : -2;
+    close(fd);
+    if (rc == 0) rc = class_table_load(t, path);
+    unlink(path);
+    return rc;
+}
+
+static void check_classes(void)
+{
+    static const struct { const char *name, *text; } bad[] = {
+        { "too few fields",      "1 paper 600 1200000:5000\n" },
+        { "too many targets",    "1 paper 600 1:1 2:1 3:1 4:1 5:1 1600000\n" },
+        { "id out of range",     "32 paper 600 1200000:5000 1600000\n" },
+        { "id not a number",     "x paper 600 1200000:5000 1600000\n" },
+        { "repeated id",         "1 paper 600 1200000:5000 1600000\n"
+                                 "1 card 600 1300000:5000 1600000\n" },
+        { "name too long",       "1 corrugated_cardboard 600 1200000:5000 1600000\n" },
+        { "min_conf over 1000",  "1 paper 1001 1200000:5000 1600000\n" },
+        { "bad return",          "1 paper 600 1200000:5000 back\n" },
+        { "target without hold", "1 paper 600 1200000: 1600000\n" },
+        { "target with no ':'",  "1 paper 600 1200000-5000 1600000\n" },
+        { "zero duty target",    "1 paper 600 0:5000 1600000\n" },
+        { "repeated name",       "1 paper 600 1200000:5000 1600000\n"
+                                 "2 paper 600 2000000:5000 1600000\n" },
+        { "comments only",       "# nothing here\n\n   # still nothing\n" },
+    };
+    class_table_t def, t;
+    class_table_default(&def, 1600000, 1200000, 2000000, 5 * NS_PER_SEC, 600);
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+        memcpy(&t, &def, sizeof(t));
+        int rc = load_text(&t, bad[i].text);
+        report("classes", bad[i].name, rc == -1 && memcmp(&t, &def, sizeof(t)) == 0);
+    }
+
+    // the example from class_table.h
+    memcpy(&t, &def, sizeof(t));
+    int rc = load_text(&t,
+        "# id  name     min_conf  targets (duty_ns:hold_ms ...)   return_ns\n"
+        "1     paper    600       1200000:5000                    1600000\n"
+        "2     plastic  600       2000000:5000                    1600000\n"
+        "3     glass    700       1400000:300 1250000:4000        1600000\n"
+        "0     reject   0         1600000:5000                    stay\n");
+    const class_entry_t *glass = class_table_by_id(&t, 3);
+    report("classes", "example file loads",
+           rc == 0 && t.count == 4 && class_table_find(&t, "glass", 5) == 3 &&
+           glass && glass->n_targets == 2 && glass->targets[1].hold_ns == 4000 * NS_PER_MS &&
+           glass->min_conf == 700 && t.by_id[0].return_ns == CLASS_RETURN_STAY);
+
+    memcpy(&t, &def, sizeof(t));
+    rc = load_text(&t, "1 paper 600 1200000:5000 1600000  # no reject line\n");
+    report("classes", "missing reject keeps the old one",
+           rc == 0 && t.count == 2 && t.by_id[0].used &&
+           memcmp(&t.by_id[0], &def.by_id[0], sizeof(t.by_id[0])) == 0);
+}
+
+// ---------- journal ----------
+#define JCAP 8
+
+static off_t slot_off(uint64_t slot)
+{
+    return JOURNAL_HDR_SIZE + (off_t)(slot * sizeof(journal_rec_t));
+}
+
+static void poke_u64(const char *path, off_t off, uint64_t v)
+{
+    int fd = open(path, O_RDWR);
+    if (fd < 0 || pwrite(fd, &v, sizeof(v), off) != (ssize_t)sizeof(v)) perror(path);
+    if (fd >= 0) close(fd);
+}
+
+// A fresh journal with seqs 1..n, job_id = 10 * seq.
+static void fill(const char *path, int n)
+{
+    unlink(path);
+    journal_t j;
+    if (journal_open(&j, path, JCAP) != 0) return;
+    for (int i = 1; i <= n; ++i) {
+        journal_rec_t r;
+        memset(&r, 0, sizeof(r));
+        r.job_id = (uint32_t)(10 * i);
+        journal_append(&j, &r);
+    }
+    journal_close(&j);
+}
+
+// What journal_open() recovers: next seq, and which seqs read back intact.
+static uint64_t reopen(const char *path, uint32_t *readable)
+{
+    journal_t j;
+    uint64_t first = 0, next = 0;
+    *readable = 0;
+    if (journal_open(&j, path, JCAP) != 0) return 0;
+    journal_range(&j, &first, &next);
+    for (uint64_t s = 1; s < 32; ++s) {
+        journal_rec_t r;
+        if (journal_read(&j, s, &r) && r.job_id == 10 * s) *readable |= 1u << s;
+    }
+    journal_close(&j);
+    return next;
+}
+
+#define SEQS(lo, hi)  ((uint32_t)(((1ull << ((hi) + 1)) - 1) & ~((1ull << (lo)) - 1)))
+
+static void check_journal(void)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/sorter_check.%d.journal", (int)getpid());
+    const off_t hint = offsetof(journal_hdr_t, next_seq);
+    uint32_t ok_seqs;
+
+    fill(path, 5);
+    report("journal", "clean reopen", reopen(path, &ok_seqs) == 6 && ok_seqs == SEQS(1, 5));
+
+    // died inside append of seq 5: slot invalidated, header not advanced
+    fill(path, 5);
+    poke_u64(path, slot_off(4), 0);
+    poke_u64(path, hint, 5);
+    uint64_t next = reopen(path, &ok_seqs);
+    report("journal", "torn record is dropped", next == 5 && ok_seqs == SEQS(1, 4));
+    {
+        journal_t j;
+        journal_rec_t r;
+        memset(&r, 0, sizeof(r));
+        r.job_id = 50;
+        int ok = journal_open(&j, path, JCAP) == 0;
+        if (ok) { journal_append(&j, &r); journal_close(&j); }
+        report("journal", "... and its seq is written again",
+               ok && reopen(path, &ok_seqs) == 6 && ok_seqs == SEQS(1, 5));
+    }
+
+    // died after the record's commit, before the header store
+    fill(path, 5);
+    poke_u64(path, hint, 3);
+    report("journal", "header behind the records", reopen(path, &ok_seqs) == 6 &&
+           ok_seqs == SEQS(1, 5));
+
+    // a seq that doesn't belong in its slot (slot 6 holds seqs 7, 15, ...)
+    fill(path, 5);
+    poke_u64(path, slot_off(6), 99);
+    report("journal", "misplaced seq ignored", reopen(path, &ok_seqs) == 6 &&
+           ok_seqs == SEQS(1, 5));
+
+    // wrapped: seq 10 was overwriting seq 2 in slot 1 when it died
+    fill(path, 10);
+    poke_u64(path, slot_off(1), 0);
+    poke_u64(path, hint, 10);
+    report("journal", "torn write after the ring wrapped", reopen(path, &ok_seqs) == 10 &&
+           ok_seqs == SEQS(3, 9));
+
+    unlink(path);
+}
+
+int main(int argc, char **argv)
+{
+    static const struct { const char *name; void (*fn)(void); } groups[] = {
+        { "vote", check_vote },
+        { "clock", check_clock },
+        { "classes", check_classes },
+        { "journal", check_journal },
+    };
+    const char *only = argc > 1 ? argv[1] : NULL;
+    for (size_t i = 0; i < sizeof(groups) / sizeof(groups[0]); ++i)
+        if (!only || strcmp(only, groups[i].name) == 0) groups[i].fn();
+    if (g_run == 0) {
+        fprintf(stderr, "usage: %s [vote|clock|classes|journal]\n", argv[0]);
+        return 2;
+    }
+    printf("[sorter] %d/%d passed\n", g_pass, g_run);
+    return g_pass == g_run ? 0 : 1;
+}
@@ -0,0 +1,15 @@
+# HAL pieces both boards use. One copy here; each project includes this
+# file and compiles the sources into its own targets, so per-target flags
+# such as TIMEBASE_SIM still apply.
+#
+# Headers are included as "hal/timebase.h"; the Beagle tree's flat
+# "timebase.h" style works through HAL_COMMON_INCLUDE_DIR/hal.
+
+set(HAL_COMMON_DIR         ${CMAKE_CURRENT_LIST_DIR})
+set(HAL_COMMON_INCLUDE_DIR ${HAL_COMMON_DIR}/include)
+set(HAL_COMMON_SOURCES
+    ${HAL_COMMON_DIR}/src/timebase.c
+    ${HAL_COMMON_DIR}/src/evlog.c
+    ${HAL_COMMON_DIR}/src/ctl.c
+    ${HAL_COMMON_DIR}/src/hal_io.c
+)
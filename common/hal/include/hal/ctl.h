@@ -0,0 +1,56 @@
+#ifndef HAL_CTL_H
+#define HAL_CTL_H
+
+// Local control socket: line-based commands over AF_UNIX (SOCK_STREAM),
+// served from the app's own loop -- no extra thread, no locks.
+//
+//   $ socat - UNIX-CONNECT:/tmp/sorter.ctl
+//   status
+//   in_flight 1 job 17 age_ms 412 ...
+//   ok
+//
+// Everything is non-blocking. ctl_poll() does one poll() with a zero
+// timeout and serves only what is already there; ctl_wait_until() is a
+// sleep_until_ns() that answers clients while it waits, so the app's
+// idle sleeps become the service time and its timed sections are never
+// held up. A client that doesn't read its replies has them buffered up
+// to CTL_OUT_LEN and is then dropped rather than waited for.
+//
+// Each reply is whatever the handler printed, then "ok" or
+// "error: <why>" on a line of its own. "help" lists the commands.
+
+#include "timebase.h"
+
+#include <stdarg.h>
+
+#define CTL_MAX_CLIENTS  4
+#define CTL_MAX_CMDS     24
+#define CTL_MAX_ARGS     8
+#define CTL_LINE_LEN     256       // longest command line
+#define CTL_OUT_LEN      8192      // reply bytes buffered per client
+
+typedef struct ctl ctl_t;
+
+// Runs one command. argv[0] is the command name. Print the reply with
+// ctl_printf(); return 0, or -1 after ctl_error().
+typedef int (*ctl_handler_t)(ctl_t *c, int argc, char **argv, void *ctx);
+
+// Binds path (a stale socket file there is removed). NULL on error.
+ctl_t *ctl_open(const char *path);
+void   ctl_close(ctl_t *c);            // also unlinks the path; NULL is fine
+
+int  ctl_register(ctl_t *c, const char *name, const char *help,
+                  ctl_handler_t fn, void *ctx);
+
+// Accepts, reads and runs whatever is ready. Never blocks. Returns the
+// number of commands run. c may be NULL (then it does nothing).
+int  ctl_poll(ctl_t *c);
+
+// sleep_until_ns(deadline), serving clients in the meantime.
+void ctl_wait_until(ctl_t *c, nsec_t deadline);
+
+// Reply text for the command being run.
+void ctl_printf(ctl_t *c, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void ctl_error(ctl_t *c, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#endif
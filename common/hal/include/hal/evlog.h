@@ -0,0 +1,66 @@
+#ifndef HAL_EVLOG_H
+#define HAL_EVLOG_H
+
+// Asynchronous binary event log.
+// EVLOG(fmt, ...) does NOT format anything: it copies a fixed-size record
+// (timestamp, pointer to the format literal, up to 4 raw arguments) into a
+// lock-free ring and returns. A background thread does the printf work,
+// so a slow serial console can never stall the caller. If the ring is
+// full the record is dropped and counted, never waited for.
+//
+//   EVLOG("[main] Received '%s' (%d bytes)\n", buf, n);
+//
+// Rules: 'fmt' must be a string literal; at most EVLOG_MAX_ARGS arguments;
+// integers, doubles and strings only. Strings are copied (EVLOG_STR_LEN
+// bytes in total per record). Before evlog_start() records are formatted
+// synchronously, so HAL code can log whether or not the app started it.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define EVLOG_MAX_ARGS   4
+#define EVLOG_STR_LEN    32
+#define EVLOG_RING_SIZE  1024   // records; must be a power of two
+
+typedef struct {
+    char type;                  // 'i', 'd' or 's'
+    union {
+        long long   i;
+        double      d;
+        const char *s;
+    } v;
+} evlog_arg_t;
+
+static inline evlog_arg_t evlog_arg_int(long long v)   { evlog_arg_t a; a.type = 'i'; a.v.i = v; return a; }
+static inline evlog_arg_t evlog_arg_dbl(double v)      { evlog_arg_t a; a.type = 'd'; a.v.d = v; return a; }
+static inline evlog_arg_t evlog_arg_str(const char *v) { evlog_arg_t a; a.type = 's'; a.v.s = v; return a; }
+
+#define EVLOG_ARG(x) _Generic((x),                         \
+        char *:       evlog_arg_str,                       \
+        const char *: evlog_arg_str,                       \
+        float:        evlog_arg_dbl,                       \
+        double:       evlog_arg_dbl,                       \
+        default:      evlog_arg_int)(x)
+
+#define EVLOG0(f)             evlog_write((f), 0, NULL)
+#define EVLOG1(f, a)          evlog_write((f), 1, (evlog_arg_t[]){ EVLOG_ARG(a) })
+#define EVLOG2(f, a, b)       evlog_write((f), 2, (evlog_arg_t[]){ EVLOG_ARG(a), EVLOG_ARG(b) })
+#define EVLOG3(f, a, b, c)    evlog_write((f), 3, (evlog_arg_t[]){ EVLOG_ARG(a), EVLOG_ARG(b), EVLOG_ARG(c) })
+#define EVLOG4(f, a, b, c, d) evlog_write((f), 4, (evlog_arg_t[]){ EVLOG_ARG(a), EVLOG_ARG(b), EVLOG_ARG(c), EVLOG_ARG(d) })
+#define EVLOG_PICK(_0, _1, _2, _3, _4, NAME, ...) NAME
+#define EVLOG(...) EVLOG_PICK(__VA_ARGS__, EVLOG4, EVLOG3, EVLOG2, EVLOG1, EVLOG0, _)(__VA_ARGS__)
+
+void evlog_write(const char *fmt, int nargs, const evlog_arg_t *args);
+
+// Starts the formatter thread writing to 'out' (NULL = stdout).
+// With 'timestamps', every line gets a "[+s.uuuuuu] " prefix.
+int  evlog_start(FILE *out, bool timestamps);
+
+// Formats everything still queued, then stops the thread.
+void evlog_stop(void);
+
+// Records lost because the ring was full.
+unsigned long long evlog_dropped(void);
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef HAL_IO_H
+#define HAL_IO_H
+
+// Optional async HAL mode: slow sysfs work (bring-up retry chains,
+// exports, blinks) runs on ONE I/O thread instead of the caller's.
+//
+// Commands go into a bounded lock-free MPSC queue (the same Vyukov ring
+// as evlog). Submitting is a few atomics -- plus one eventfd write if
+// the I/O thread was asleep -- and never waits: a full queue is an
+// error, not a stall. Completion is reported three ways, pick any:
+//   - a hal_io_future_t the caller owns (poll it, or hal_io_wait() on it)
+//   - hal_io_eventfd(), readable after every completion (for poll loops)
+//   - nothing at all (fire and forget)
+//
+// Coalescing: commands that share a hal_io_coalesce_t only matter as
+// the latest one. When the thread gets to a command that a newer one
+// has already replaced, it skips the sysfs write and completes it with
+// -ECANCELED -- so a control loop can queue a duty every tick and only
+// the most recent target is ever written.
+//
+// Without hal_io_start() the *_async() calls in the drivers run their
+// command right away on the caller's thread, so code is written once.
+// While the thread runs, a driver instance should only be used through
+// its async calls (the thread owns its sysfs state).
+
+#include "timebase.h"
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HAL_IO_QUEUE   64      // commands; must be a power of two
+
+// Plain fields, read and written with __atomic builtins, so driver
+// structs can embed them without pulling <stdatomic.h> into headers that
+// C++ code includes.
+typedef struct {
+    int    state;              // 0 = pending, 1 = done
+    int    rc;                 // the command's return, -ECANCELED if superseded
+    nsec_t t_submit;
+    nsec_t t_done;
+} hal_io_future_t;
+
+// One per coalescing target (e.g. a servo's duty): the newest command's
+// generation. Zero-initialised is ready to use.
+typedef unsigned long long hal_io_coalesce_t;
+
+typedef union {
+    long long i;
+    double    d;
+} hal_io_arg_t;
+
+typedef int (*hal_io_fn)(void *ctx, hal_io_arg_t arg);
+
+typedef struct {
+    unsigned long long submitted;
+    unsigned long long done;
+    unsigned long long superseded;   // skipped: a newer command replaced them
+    unsigned long long queue_full;   // refused at submit
+    nsec_t max_wait_ns;              // submit -> start of execution
+    nsec_t max_exec_ns;              // time inside the command
+} hal_io_stats_t;
+
+int  hal_io_start(void);
+void hal_io_stop(void);              // runs what is still queued first
+bool hal_io_running(void);
+
+// Queues fn(ctx, arg). co may be NULL (never superseded); f may be NULL.
+// Returns 0, or -1 if the queue is full (f is then completed with -EAGAIN).
+// Not running: fn runs right here and f is complete on return.
+int  hal_io_submit(hal_io_fn fn, void *ctx, hal_io_arg_t arg,
+                   hal_io_coalesce_t *co, hal_io_future_t *f);
+
+// Futures. hal_io_wait() blocks until f completes or 'deadline' (now_ns()
+// time, 0 = no limit) passes; returns f->rc, or -ETIMEDOUT.
+static inline bool hal_io_done(hal_io_future_t *f)
+{
+    return __atomic_load_n(&f->state, __ATOMIC_ACQUIRE) != 0;
+}
+int  hal_io_wait(hal_io_future_t *f, nsec_t deadline);
+
+// Counter eventfd, readable once anything completes (-1 if not running).
+int  hal_io_eventfd(void);
+
+void hal_io_get_stats(hal_io_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
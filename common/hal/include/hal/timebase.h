@@ -0,0 +1,132 @@
+#ifndef HAL_TIMEBASE_H
+#define HAL_TIMEBASE_H
+
+// One clock for everything: timestamps, intervals and sleeps.
+//  - now_ns()      CLOCK_MONOTONIC (slewed by NTP, never jumps)
+//  - now_raw_ns()  CLOCK_MONOTONIC_RAW (pure hardware rate)
+//  - cycles_now()  optional free-running counter for sub-µs deltas,
+//                  converted with the ratio measured by timebase_init()
+// All times are nsec_t: signed 64-bit nanoseconds, so differences are
+// just subtraction and never need timespec borrow/carry.
+//
+// Simulation builds (-DTIMEBASE_SIM, CMake option SIM_CLOCK) swap in a
+// virtual clock: no sleep really waits. Threads that called
+// timebase_thread_attach() (timebase_init() attaches its caller) are the
+// "participants"; once every participant is asleep, virtual time jumps
+// straight to the earliest participant deadline. Other threads (HAL
+// pollers, the logger) just follow virtual time and never hold it back.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int64_t nsec_t;
+
+#define NS_PER_US   1000LL
+#define NS_PER_MS   1000000LL
+#define NS_PER_SEC  1000000000LL
+
+static inline nsec_t ns_from_timespec(const struct timespec *t)
+{
+    return (nsec_t)t->tv_sec * NS_PER_SEC + t->tv_nsec;
+}
+
+static inline struct timespec timespec_from_ns(nsec_t ns)
+{
+    struct timespec t = { (time_t)(ns / NS_PER_SEC), (long)(ns % NS_PER_SEC) };
+    return t;
+}
+
+#ifdef TIMEBASE_SIM
+nsec_t timebase_sim_now(void);
+static inline nsec_t now_ns(void)     { return timebase_sim_now(); }
+static inline nsec_t now_raw_ns(void) { return timebase_sim_now(); }
+#else
+static inline nsec_t now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ns_from_timespec(&t);
+}
+
+static inline nsec_t now_raw_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+    return ns_from_timespec(&t);
+}
+#endif
+
+static inline long long now_ms(void)       { return now_ns() / NS_PER_MS; }
+static inline nsec_t    ns_since(nsec_t t0) { return now_ns() - t0; }
+static inline long long ns_to_us(nsec_t ns) { return ns / NS_PER_US; }
+static inline long long ns_to_ms(nsec_t ns) { return ns / NS_PER_MS; }
+
+// Wall-clock time (CLOCK_REALTIME) for records meant to outlive the
+// process. On the virtual clock it starts at the real time and then
+// advances with virtual time, so a simulated day spans a day.
+nsec_t wall_ns(void);
+
+// Maps a CLOCK_REALTIME stamp (e.g. a kernel SO_TIMESTAMPNS receive time)
+// onto the now_ns() timeline by subtracting its age.
+nsec_t realtime_to_mono_ns(nsec_t realtime);
+
+// Sleeps. All of them resume after signals until the time is really up.
+void sleep_ns(nsec_t ns);
+void sleep_ms(long long ms);
+void sleep_until_ns(nsec_t deadline);   // absolute now_ns() time
+
+// ---- cycle counter ------------------------------------------------------
+// aarch64: CNTVCT_EL0, x86: TSC. Elsewhere cycles_now() is now_raw_ns()
+// and the conversion is 1:1, so callers never need a second code path.
+static inline uint64_t cycles_now(void)
+{
+#if defined(TIMEBASE_SIM)
+    return (uint64_t)now_raw_ns();
+#elif defined(__aarch64__)
+    uint64_t v;
+    __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(v) :: "memory");
+    return v;
+#elif defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ __volatile__("lfence; rdtsc" : "=a"(lo), "=d"(hi) :: "memory");
+    return ((uint64_t)hi << 32) | lo;
+#else
+    return (uint64_t)now_raw_ns();
+#endif
+}
+
+// Converts a cycles_now() delta to ns (valid after timebase_init()).
+nsec_t cycles_to_ns(uint64_t delta);
+
+// ---- start-up validation ------------------------------------------------
+typedef struct {
+    bool   vdso;              // kernel mapped a vDSO for us
+    double mono_ns_per_call;  // measured cost of now_ns()
+    double raw_ns_per_call;   // measured cost of now_raw_ns()
+    bool   fast;              // cheap enough to call on hot paths
+    long   resolution_ns;     // clock_getres(CLOCK_MONOTONIC)
+    bool   cycles_hw;         // cycles_now() is a real hardware counter
+    double cycles_hz;         // calibrated counter rate
+} timebase_report_t;
+
+// Measures clock read cost and calibrates the cycle counter (~20 ms).
+// Returns 0 if the clock is fast enough, -1 if reads fall back to syscalls.
+int  timebase_init(timebase_report_t *out);
+void timebase_print(const timebase_report_t *r, const char *tag);
+
+// ---- virtual clock (no-ops unless built with TIMEBASE_SIM) --------------
+// Calling thread drives virtual time. -1 (and a message) if all
+// participant slots are taken: the thread then only follows it.
+int  timebase_thread_attach(void);
+void timebase_thread_detach(void);   // call before a participant exits
+bool timebase_is_virtual(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
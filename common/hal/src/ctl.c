@@ -0,0 +1,316 @@
+// Line-based command socket, served from the caller's loop.
+
+#define _GNU_SOURCE
+#include "hal/ctl.h"
+#include "hal/timebase.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// below this a wait just sleeps: poll() isn't worth it, and the deadline
+// stays as sharp as a plain sleep_until_ns()
+#define CTL_MIN_POLL_NS  (100 * NS_PER_US)
+
+typedef struct {
+    int    fd;                  // -1 = free slot
+    char   in[CTL_LINE_LEN];
+    size_t in_len;
+    bool   skipping;            // rest of an over-long line
+    char   out[CTL_OUT_LEN];
+    size_t out_len;
+    bool   overflow;            // reply didn't fit: drop the client
+} ctl_client_t;
+
+typedef struct {
+    const char   *name;
+    const char   *help;
+    ctl_handler_t fn;
+    void         *ctx;
+} ctl_cmd_t;
+
+struct ctl {
+    int  lfd;
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    ctl_client_t cl[CTL_MAX_CLIENTS];
+    ctl_cmd_t    cmd[CTL_MAX_CMDS];
+    int          n_cmds;
+    ctl_client_t *cur;          // whose command is running
+    bool          failed;       // ctl_error() was called
+};
+
+static void client_close(ctl_client_t *k)
+{
+    if (k->fd >= 0) close(k->fd);
+    k->fd       = -1;
+    k->in_len   = 0;
+    k->out_len  = 0;
+    k->skipping = false;
+    k->overflow = false;
+}
+
+static void out_vappend(ctl_client_t *k, const char *fmt, va_list ap)
+{
+    if (k->overflow) return;
+    size_t room = sizeof(k->out) - k->out_len;
+    int n = vsnprintf(k->out + k->out_len, room, fmt, ap);
+    if (n < 0 || (size_t)n >= room) {
+        k->overflow = true;
+        return;
+    }
+    k->out_len += (size_t)n;
+}
+
+static void out_append(ctl_client_t *k, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    out_vappend(k, fmt, ap);
+    va_end(ap);
+}
+
+void ctl_printf(ctl_t *c, const char *fmt, ...)
+{
+    if (!c || !c->cur) return;
+    va_list ap;
+    va_start(ap, fmt);
+    out_vappend(c->cur, fmt, ap);
+    va_end(ap);
+}
+
+void ctl_error(ctl_t *c, const char *fmt, ...)
+{
+    if (!c || !c->cur || c->failed) return;
+    c->failed = true;
+    out_append(c->cur, "error: ");
+    va_list ap;
+    va_start(ap, fmt);
+    out_vappend(c->cur, fmt, ap);
+    va_end(ap);
+    out_append(c->cur, "\n");
+}
+
+// Sends what the socket takes now; the rest waits for POLLOUT.
+static void client_flush(ctl_client_t *k)
+{
+    while (k->out_len > 0) {
+        ssize_t n = send(k->fd, k->out, k->out_len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) client_close(k);
+            return;
+        }
+        memmove(k->out, k->out + n, k->out_len - (size_t)n);
+        k->out_len -= (size_t)n;
+    }
+}
+
+// --------------------------------------------------
+
+ctl_t *ctl_open(const char *path)
+{
+    static ctl_t inst;          // one per process is all the apps need
+    ctl_t *c = &inst;
+
+    if (strlen(path) >= sizeof(c->path)) {
+        fprintf(stderr, "[ctl] socket path too long: %s\n", path);
+        return NULL;
+    }
+    memset(c, 0, sizeof(*c));
+    snprintf(c->path, sizeof(c->path), "%s", path);
+    for (int i = 0; i < CTL_MAX_CLIENTS; ++i) c->cl[i].fd = -1;
+
+    // a socket left behind by a crashed run; anything else we leave alone
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+
+    c->lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c->lfd < 0) {
+        perror("[ctl] socket");
+        return NULL;
+    }
+    struct sockaddr_un a;
+    memset(&a, 0, sizeof(a));
+    a.sun_family = AF_UNIX;
+    memcpy(a.sun_path, c->path, sizeof(a.sun_path));
+    if (bind(c->lfd, (struct sockaddr *)&a, sizeof(a)) != 0 ||
+        listen(c->lfd, CTL_MAX_CLIENTS) != 0) {
+        perror("[ctl] bind");
+        close(c->lfd);
+        return NULL;
+    }
+    return c;
+}
+
+void ctl_close(ctl_t *c)
+{
+    if (!c) return;
+    for (int i = 0; i < CTL_MAX_CLIENTS; ++i) client_close(&c->cl[i]);
+    close(c->lfd);
+    unlink(c->path);
+}
+
+int ctl_register(ctl_t *c, const char *name, const char *help,
+                 ctl_handler_t fn, void *ctx)
+{
+    if (!c) return -1;
+    if (c->n_cmds >= CTL_MAX_CMDS) {
+        fprintf(stderr, "[ctl] too many commands, '%s' not added\n", name);
+        return -1;
+    }
+    c->cmd[c->n_cmds++] = (ctl_cmd_t){ name, help, fn, ctx };
+    return 0;
+}
+
+// --------------------------------------------------
+
+static void run_line(ctl_t *c, ctl_client_t *k, char *line)
+{
+    char *argv[CTL_MAX_ARGS + 1], *save = NULL;
+    int argc = 0;
+    for (char *p = strtok_r(line, " \t\r", &save); p; p = strtok_r(NULL, " \t\r", &save)) {
+        if (argc == CTL_MAX_ARGS) {
+            out_append(k, "error: more than %d words\n", CTL_MAX_ARGS);
+            return;
+        }
+        argv[argc++] = p;
+    }
+    if (argc == 0) return;
+    argv[argc] = NULL;
+
+    c->cur    = k;
+    c->failed = false;
+    if (strcmp(argv[0], "help") == 0) {
+        for (int i = 0; i < c->n_cmds; ++i)
+            ctl_printf(c, "%-10s %s\n", c->cmd[i].name, c->cmd[i].help);
+    } else {
+        int i = 0;
+        while (i < c->n_cmds && strcmp(argv[0], c->cmd[i].name) != 0) i++;
+        if (i == c->n_cmds)
+            ctl_error(c, "unknown command '%s' (try help)", argv[0]);
+        else if (c->cmd[i].fn(c, argc, argv, c->cmd[i].ctx) != 0)
+            ctl_error(c, "%s failed", argv[0]);
+    }
+    if (!c->failed) out_append(k, "ok\n");
+    c->cur = NULL;
+}
+
+// One recv(), then every complete line in the buffer. Returns lines run.
+static int client_read(ctl_t *c, ctl_client_t *k)
+{
+    ssize_t n = recv(k->fd, k->in + k->in_len, sizeof(k->in) - k->in_len, MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        client_close(k);
+        return 0;
+    }
+    if (n < 0) return 0;
+    k->in_len += (size_t)n;
+
+    int ran = 0;
+    char *start = k->in, *end = k->in + k->in_len, *nl;
+    while ((nl = memchr(start, '\n', (size_t)(end - start))) != NULL) {
+        *nl = '\0';
+        if (k->skipping) k->skipping = false;
+        else {
+            run_line(c, k, start);
+            ran++;
+        }
+        start = nl + 1;
+    }
+    k->in_len = (size_t)(end - start);
+    memmove(k->in, start, k->in_len);
+
+    // a full buffer with no newline can never become a command
+    if (k->in_len == sizeof(k->in)) {
+        if (!k->skipping) out_append(k, "error: line longer than %d bytes\n", CTL_LINE_LEN);
+        k->skipping = true;
+        k->in_len   = 0;
+    }
+    return ran;
+}
+
+static void accept_clients(ctl_t *c)
+{
+    for (;;) {
+        int fd = accept4(c->lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;      // EAGAIN: no more waiting
+
+        int i = 0;
+        while (i < CTL_MAX_CLIENTS && c->cl[i].fd >= 0) i++;
+        if (i == CTL_MAX_CLIENTS) {
+            static const char busy[] = "error: too many clients\n";
+            (void)send(fd, busy, sizeof(busy) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+            close(fd);
+            continue;
+        }
+        c->cl[i].fd = fd;
+    }
+}
+
+// One ppoll() over the listener and the clients, then serve what's ready.
+static int serve(ctl_t *c, const struct timespec *timeout)
+{
+    struct pollfd pfd[1 + CTL_MAX_CLIENTS];
+    ctl_client_t *who[1 + CTL_MAX_CLIENTS];
+    int n = 0;
+
+    pfd[n] = (struct pollfd){ c->lfd, POLLIN, 0 };
+    who[n++] = NULL;
+    for (int i = 0; i < CTL_MAX_CLIENTS; ++i) {
+        ctl_client_t *k = &c->cl[i];
+        if (k->fd < 0) continue;
+        pfd[n] = (struct pollfd){ k->fd, (short)(POLLIN | (k->out_len ? POLLOUT : 0)), 0 };
+        who[n++] = k;
+    }
+
+    if (ppoll(pfd, (nfds_t)n, timeout, NULL) <= 0) return 0;
+
+    int ran = 0;
+    for (int i = 1; i < n; ++i) {
+        ctl_client_t *k = who[i];
+        if (pfd[i].revents & (POLLERR | POLLNVAL)) {
+            client_close(k);
+            continue;
+        }
+        if (pfd[i].revents & (POLLIN | POLLHUP)) ran += client_read(c, k);
+        if (k->fd < 0) continue;
+        client_flush(k);
+        if (k->overflow) {
+            // not reading its replies, or asked for more than we buffer
+            fprintf(stderr, "[ctl] client dropped: reply over %d bytes\n", CTL_OUT_LEN);
+            client_close(k);
+        }
+    }
+    if (pfd[0].revents & POLLIN) accept_clients(c);
+    return ran;
+}
+
+int ctl_poll(ctl_t *c)
+{
+    static const struct timespec zero = { 0, 0 };
+    return c ? serve(c, &zero) : 0;
+}
+
+void ctl_wait_until(ctl_t *c, nsec_t deadline)
+{
+    // virtual time doesn't pass inside poll(): serve once, then let the
+    // simulated sleep jump ahead
+    if (!c || timebase_is_virtual()) {
+        ctl_poll(c);
+        sleep_until_ns(deadline);
+        return;
+    }
+    for (;;) {
+        nsec_t left = deadline - now_ns();
+        if (left < CTL_MIN_POLL_NS) break;
+        struct timespec t = timespec_from_ns(left - CTL_MIN_POLL_NS / 2);
+        serve(c, &t);
+    }
+    sleep_until_ns(deadline);
+}
@@ -0,0 +1,215 @@
+// Lock-free event log: bounded MPSC ring of fixed-size binary records.
+//
+// Each slot carries a sequence number (Vyukov bounded queue): a producer
+// claims position p with one CAS on the tail when slot.seq == p, fills the
+// record, then publishes seq = p + 1. The formatter thread consumes slots
+// with seq == p + 1 in order and hands them back with seq = p + SIZE.
+
+#include "hal/evlog.h"
+#include "hal/timebase.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#define EVLOG_MASK      (EVLOG_RING_SIZE - 1)
+#define EVLOG_POLL_NS   (5 * NS_PER_MS)
+
+typedef struct {
+    const char *fmt;
+    nsec_t      t_ns;
+    int         nargs;
+    evlog_arg_t args[EVLOG_MAX_ARGS];   // 's' args point into str[]
+    char        str[EVLOG_STR_LEN];
+} evlog_rec_t;
+
+typedef struct {
+    atomic_size_t seq;
+    evlog_rec_t   rec;
+} evlog_slot_t;
+
+static evlog_slot_t g_ring[EVLOG_RING_SIZE];
+static atomic_size_t g_tail = 0;      // next position producers claim
+static size_t        g_head = 0;      // next position the formatter reads
+static atomic_ullong g_dropped = 0;
+static atomic_int    g_running = 0;
+static pthread_t     g_thread;
+static FILE         *g_out = NULL;
+static bool          g_stamps = false;
+static nsec_t        g_t0 = 0;
+
+// Copies strings into rec->str and repoints the args there.
+static void capture(evlog_rec_t *r, const char *fmt, int nargs, const evlog_arg_t *args)
+{
+    size_t used = 0;
+    r->fmt   = fmt;
+    r->nargs = nargs > EVLOG_MAX_ARGS ? EVLOG_MAX_ARGS : nargs;
+    for (int i = 0; i < r->nargs; ++i) {
+        r->args[i] = args[i];
+        if (args[i].type != 's') continue;
+
+        const char *s = args[i].v.s ? args[i].v.s : "(null)";
+        size_t room = sizeof(r->str) - used;
+        size_t n = strnlen(s, room ? room - 1 : 0);
+        memcpy(r->str + used, s, n);
+        r->str[used + n] = '\0';
+        r->args[i].v.s = r->str + used;
+        used += (room ? n + 1 : 0);
+        if (used >= sizeof(r->str)) used = sizeof(r->str) - 1;   // later strings become ""
+    }
+}
+
+// printf one record, walking the format so each conversion gets the
+// argument type it was captured as.
+static void format_rec(FILE *out, const evlog_rec_t *r)
+{
+    if (g_stamps) {
+        nsec_t t = r->t_ns - g_t0;
+        fprintf(out, "[+%lld.%06lld] ", (long long)(t / NS_PER_SEC),
+                (long long)((t % NS_PER_SEC) / NS_PER_US));
+    }
+
+    const char *p = r->fmt;
+    int ai = 0;
+    while (*p) {
+        if (*p != '%') {
+            const char *q = strchr(p, '%');
+            size_t n = q ? (size_t)(q - p) : strlen(p);
+            fwrite(p, 1, n, out);
+            p += n;
+            continue;
+        }
+        if (p[1] == '%') { fputc('%', out); p += 2; continue; }
+
+        // copy flags/width/precision, drop length modifiers
+        char spec[24];
+        size_t n = 0;
+        spec[n++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && n < sizeof(spec) - 4) spec[n++] = *p++;
+        while (*p && strchr("hlLqjzt", *p)) p++;
+        char conv = *p ? *p++ : 'd';
+
+        const evlog_arg_t *a = (ai < r->nargs) ? &r->args[ai++] : NULL;
+        if (!a) { fputs("<?>", out); continue; }
+
+        if (strchr("diouxXc", conv)) {
+            if (conv != 'c') { spec[n++] = 'l'; spec[n++] = 'l'; }
+            spec[n++] = conv; spec[n] = '\0';
+            long long v = (a->type == 'd') ? (long long)a->v.d : a->v.i;
+            if (conv == 'c') fprintf(out, spec, (int)v);
+            else             fprintf(out, spec, v);
+        } else if (strchr("fFeEgGaA", conv)) {
+            spec[n++] = conv; spec[n] = '\0';
+            fprintf(out, spec, (a->type == 'd') ? a->v.d : (double)a->v.i);
+        } else if (conv == 's') {
+            spec[n++] = 's'; spec[n] = '\0';
+            fprintf(out, spec, (a->type == 's') ? a->v.s : "<?>");
+        } else {
+            fputs("<?>", out);
+        }
+    }
+}
+
+void evlog_write(const char *fmt, int nargs, const evlog_arg_t *args)
+{
+    nsec_t t = now_ns();
+
+    if (!atomic_load_explicit(&g_running, memory_order_acquire)) {
+        // no formatter thread: behave like printf
+        evlog_rec_t r;
+        r.t_ns = t;
+        capture(&r, fmt, nargs, args);
+        format_rec(g_out ? g_out : stdout, &r);
+        return;
+    }
+
+    size_t pos = atomic_load_explicit(&g_tail, memory_order_relaxed);
+    evlog_slot_t *slot;
+    for (;;) {
+        slot = &g_ring[pos & EVLOG_MASK];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&g_tail, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (dif < 0) {
+            atomic_fetch_add_explicit(&g_dropped, 1, memory_order_relaxed);
+            return;                                  // full: drop, never block
+        } else {
+            pos = atomic_load_explicit(&g_tail, memory_order_relaxed);
+        }
+    }
+
+    slot->rec.t_ns = t;
+    capture(&slot->rec, fmt, nargs, args);
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+}
+
+// Formats everything published so far. Returns how many records.
+static int drain(void)
+{
+    int n = 0;
+    for (;;) {
+        evlog_slot_t *slot = &g_ring[g_head & EVLOG_MASK];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq != g_head + 1) break;
+        format_rec(g_out, &slot->rec);
+        atomic_store_explicit(&slot->seq, g_head + EVLOG_RING_SIZE, memory_order_release);
+        g_head++;
+        n++;
+    }
+    if (n) fflush(g_out);
+    return n;
+}
+
+static void *evlog_thread(void *unused)
+{
+    (void)unused;
+    unsigned long long reported = 0;
+
+    while (atomic_load(&g_running)) {
+        if (drain() == 0) sleep_ns(EVLOG_POLL_NS);
+
+        unsigned long long d = atomic_load(&g_dropped);
+        if (d != reported) {
+            fprintf(g_out, "[evlog] %llu records dropped (ring full)\n", d - reported);
+            reported = d;
+        }
+    }
+    drain();
+    return NULL;
+}
+
+int evlog_start(FILE *out, bool timestamps)
+{
+    if (atomic_load(&g_running)) return 0;
+
+    for (size_t i = 0; i < EVLOG_RING_SIZE; ++i)
+        atomic_store(&g_ring[i].seq, i);
+    atomic_store(&g_tail, 0);
+    g_head   = 0;
+    g_out    = out ? out : stdout;
+    g_stamps = timestamps;
+    g_t0     = now_ns();
+
+    atomic_store(&g_running, 1);
+    if (pthread_create(&g_thread, NULL, evlog_thread, NULL) != 0) {
+        atomic_store(&g_running, 0);
+        perror("evlog pthread_create");
+        return -1;
+    }
+    return 0;
+}
+
+void evlog_stop(void)
+{
+    if (!atomic_exchange(&g_running, 0)) return;
+    pthread_join(g_thread, NULL);
+    fflush(g_out);
+}
+
+unsigned long long evlog_dropped(void)
+{
+    return atomic_load(&g_dropped);
+}
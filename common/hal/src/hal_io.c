@@ -0,0 +1,264 @@
+// One I/O thread behind a bounded MPSC command ring.
+//
+// The ring is evlog's: each slot carries a sequence number, a producer
+// claims position p with one CAS on the tail when slot.seq == p, fills
+// the command and publishes seq = p + 1; the I/O thread runs slots with
+// seq == p + 1 in order and hands them back with seq = p + QUEUE.
+//
+// The I/O thread sleeps in read() on an eventfd when the ring is empty.
+// It raises g_idle first and checks the ring once more, so a producer
+// only pays for the eventfd write when the thread might really be asleep.
+
+#define _GNU_SOURCE
+#include "hal/hal_io.h"
+#include "hal/timebase.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define HAL_IO_MASK  (HAL_IO_QUEUE - 1)
+
+typedef struct {
+    hal_io_fn          fn;
+    void              *ctx;
+    hal_io_arg_t       arg;
+    hal_io_coalesce_t *co;
+    unsigned long long gen;       // *co when this command was queued
+    hal_io_future_t   *f;
+    nsec_t             t_submit;
+} hal_io_cmd_t;
+
+typedef struct {
+    atomic_size_t seq;
+    hal_io_cmd_t  cmd;
+} hal_io_slot_t;
+
+static hal_io_slot_t g_ring[HAL_IO_QUEUE];
+static atomic_size_t g_tail = 0;      // next position producers claim
+static size_t        g_head = 0;      // next position the I/O thread runs
+static atomic_int    g_running = 0;
+static atomic_int    g_idle = 0;      // I/O thread is (about to be) asleep
+static pthread_t     g_thread;
+static int           g_wake_fd = -1;  // producers -> I/O thread
+static int           g_done_fd = -1;  // I/O thread -> whoever polls it
+
+static atomic_ullong g_submitted, g_done, g_superseded, g_queue_full;
+static atomic_llong  g_max_wait_ns, g_max_exec_ns;
+
+static long futex(int *addr, int op, int val, const struct timespec *t)
+{
+    return syscall(SYS_futex, addr, op, val, t, NULL, 0);
+}
+
+static void complete(hal_io_future_t *f, int rc)
+{
+    if (!f) return;
+    f->rc     = rc;
+    f->t_done = now_ns();
+    __atomic_store_n(&f->state, 1, __ATOMIC_RELEASE);
+    futex(&f->state, FUTEX_WAKE_PRIVATE, INT_MAX, NULL);
+}
+
+static void note_max(atomic_llong *m, long long v)
+{
+    if (v > atomic_load_explicit(m, memory_order_relaxed))
+        atomic_store_explicit(m, v, memory_order_relaxed);   // one writer
+}
+
+static void execute(const hal_io_cmd_t *c)
+{
+    nsec_t start = now_ns();
+    int rc;
+    if (c->co && __atomic_load_n(c->co, __ATOMIC_ACQUIRE) != c->gen) {
+        rc = -ECANCELED;                // a newer command has the last word
+        atomic_fetch_add_explicit(&g_superseded, 1, memory_order_relaxed);
+    } else {
+        rc = c->fn(c->ctx, c->arg);
+        note_max(&g_max_exec_ns, now_ns() - start);
+    }
+    note_max(&g_max_wait_ns, start - c->t_submit);
+    atomic_fetch_add_explicit(&g_done, 1, memory_order_relaxed);
+    complete(c->f, rc);
+
+    uint64_t one = 1;
+    if (g_done_fd >= 0 && write(g_done_fd, &one, sizeof(one)) < 0) {
+        // counter saturated: readers see it readable either way
+    }
+}
+
+// Runs the next published command, if any.
+static bool run_one(void)
+{
+    hal_io_slot_t *slot = &g_ring[g_head & HAL_IO_MASK];
+    if (atomic_load(&slot->seq) != g_head + 1) return false;
+    hal_io_cmd_t c = slot->cmd;
+    atomic_store_explicit(&slot->seq, g_head + HAL_IO_QUEUE, memory_order_release);
+    g_head++;
+    execute(&c);
+    return true;
+}
+
+static void *io_thread(void *unused)
+{
+    (void)unused;
+    for (;;) {
+        if (run_one()) continue;
+
+        atomic_store(&g_idle, 1);
+        if (run_one()) {                 // raced with a submit
+            atomic_store(&g_idle, 0);
+            continue;
+        }
+        if (!atomic_load(&g_running)) break;
+        uint64_t v;
+        if (read(g_wake_fd, &v, sizeof(v)) < 0 && errno != EINTR) {
+            perror("hal_io wake");
+            break;
+        }
+        atomic_store(&g_idle, 0);
+    }
+    return NULL;
+}
+
+// --------------------------------------------------
+
+int hal_io_start(void)
+{
+    if (atomic_load(&g_running)) return 0;
+
+    for (size_t i = 0; i < HAL_IO_QUEUE; ++i)
+        atomic_store(&g_ring[i].seq, i);
+    atomic_store(&g_tail, 0);
+    g_head = 0;
+
+    g_wake_fd = eventfd(0, EFD_CLOEXEC);
+    g_done_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (g_wake_fd < 0 || g_done_fd < 0) {
+        perror("hal_io eventfd");
+        hal_io_stop();
+        return -1;
+    }
+
+    atomic_store(&g_running, 1);
+    if (pthread_create(&g_thread, NULL, io_thread, NULL) != 0) {
+        perror("hal_io pthread_create");
+        atomic_store(&g_running, 0);
+        hal_io_stop();
+        return -1;
+    }
+    return 0;
+}
+
+void hal_io_stop(void)
+{
+    if (atomic_exchange(&g_running, 0)) {
+        uint64_t one = 1;
+        if (write(g_wake_fd, &one, sizeof(one)) < 0)
+            perror("hal_io wake");
+        pthread_join(g_thread, NULL);   // drains the ring first
+    }
+    if (g_wake_fd >= 0) close(g_wake_fd);
+    if (g_done_fd >= 0) close(g_done_fd);
+    g_wake_fd = g_done_fd = -1;
+}
+
+bool hal_io_running(void)
+{
+    return atomic_load(&g_running) != 0;
+}
+
+int hal_io_submit(hal_io_fn fn, void *ctx, hal_io_arg_t arg,
+                  hal_io_coalesce_t *co, hal_io_future_t *f)
+{
+    nsec_t t = now_ns();
+    if (f) {
+        f->state    = 0;
+        f->rc       = 0;
+        f->t_submit = t;
+        f->t_done   = 0;
+    }
+    atomic_fetch_add_explicit(&g_submitted, 1, memory_order_relaxed);
+
+    if (!atomic_load_explicit(&g_running, memory_order_acquire)) {
+        // synchronous mode: same call, the caller's thread
+        if (co) __atomic_add_fetch(co, 1, __ATOMIC_ACQ_REL);
+        int rc = fn(ctx, arg);
+        atomic_fetch_add_explicit(&g_done, 1, memory_order_relaxed);
+        if (f) {
+            f->rc     = rc;
+            f->t_done = now_ns();
+            __atomic_store_n(&f->state, 1, __ATOMIC_RELEASE);
+        }
+        return 0;
+    }
+
+    size_t pos = atomic_load_explicit(&g_tail, memory_order_relaxed);
+    hal_io_slot_t *slot;
+    for (;;) {
+        slot = &g_ring[pos & HAL_IO_MASK];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&g_tail, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (dif < 0) {
+            atomic_fetch_add_explicit(&g_queue_full, 1, memory_order_relaxed);
+            complete(f, -EAGAIN);               // full: refuse, never block
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&g_tail, memory_order_relaxed);
+        }
+    }
+
+    // only a command that got a slot may supersede the ones before it
+    unsigned long long gen = co ? __atomic_add_fetch(co, 1, __ATOMIC_ACQ_REL) : 0;
+    slot->cmd = (hal_io_cmd_t){ fn, ctx, arg, co, gen, f, t };
+    atomic_store(&slot->seq, pos + 1);
+
+    // pairs with the idle flag + second look in io_thread()
+    if (atomic_exchange(&g_idle, 0)) {
+        uint64_t one = 1;
+        if (write(g_wake_fd, &one, sizeof(one)) < 0)
+            perror("hal_io wake");
+    }
+    return 0;
+}
+
+int hal_io_wait(hal_io_future_t *f, nsec_t deadline)
+{
+    while (!hal_io_done(f)) {
+        struct timespec ts, *tp = NULL;
+        if (deadline) {
+            nsec_t left = deadline - now_ns();
+            if (left <= 0) return -ETIMEDOUT;
+            ts = timespec_from_ns(left);
+            tp = &ts;
+        }
+        futex(&f->state, FUTEX_WAIT_PRIVATE, 0, tp);
+    }
+    return f->rc;
+}
+
+int hal_io_eventfd(void)
+{
+    return g_done_fd;
+}
+
+void hal_io_get_stats(hal_io_stats_t *out)
+{
+    out->submitted   = atomic_load(&g_submitted);
+    out->done        = atomic_load(&g_done);
+    out->superseded  = atomic_load(&g_superseded);
+    out->queue_full  = atomic_load(&g_queue_full);
+    out->max_wait_ns = atomic_load(&g_max_wait_ns);
+    out->max_exec_ns = atomic_load(&g_max_exec_ns);
+}
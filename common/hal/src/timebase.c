@@ -0,0 +1,246 @@
+// Shared monotonic clock: sleeps, vDSO cost check, cycle-counter calibration.
+
+#include "hal/timebase.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/auxv.h>
+
+#define TB_COST_LOOPS       2000
+#define TB_FAST_LIMIT_NS    250.0        // vDSO reads are well under this
+#define TB_CAL_WINDOW_NS    (20 * NS_PER_MS)
+#define TB_CYC_SHIFT        24
+
+// ns = (cycles * mult) >> shift; 1:1 until calibrated
+static uint64_t g_cyc_mult = 1ULL << TB_CYC_SHIFT;
+
+#ifdef TIMEBASE_SIM
+// ---- virtual clock ------------------------------------------------------
+#define TB_SIM_MAX_SLEEPERS  64
+#define TB_SIM_START_NS      NS_PER_SEC          // keeps "now - x" positive
+#define TB_SIM_PASSIVE_NS    (1 * NS_PER_MS)     // real-time cap for non-participants
+
+static pthread_mutex_t g_sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_sim_cv   = PTHREAD_COND_INITIALIZER;
+static nsec_t          g_sim_now  = TB_SIM_START_NS;
+static int             g_sim_participants = 0;
+static int             g_sim_asleep = 0;        // participants currently sleeping
+static nsec_t          g_sim_wake[TB_SIM_MAX_SLEEPERS];  // participant deadlines, 0 = free
+static _Thread_local bool tl_participant = false;
+
+nsec_t timebase_sim_now(void)
+{
+    pthread_mutex_lock(&g_sim_lock);
+    nsec_t t = g_sim_now;
+    pthread_mutex_unlock(&g_sim_lock);
+    return t;
+}
+
+// If every participant is asleep, jump to the earliest deadline.
+// Caller holds g_sim_lock.
+static void sim_maybe_advance(void)
+{
+    if (g_sim_participants == 0 || g_sim_asleep < g_sim_participants) return;
+    nsec_t next = 0;
+    for (int i = 0; i < TB_SIM_MAX_SLEEPERS; ++i) {
+        if (g_sim_wake[i] && (next == 0 || g_sim_wake[i] < next)) next = g_sim_wake[i];
+    }
+    if (next > g_sim_now) g_sim_now = next;
+    pthread_cond_broadcast(&g_sim_cv);
+}
+
+void sleep_until_ns(nsec_t deadline)
+{
+    pthread_mutex_lock(&g_sim_lock);
+    if (deadline <= g_sim_now) { pthread_mutex_unlock(&g_sim_lock); return; }
+
+    if (!tl_participant) {
+        if (g_sim_participants == 0) {
+            g_sim_now = deadline;                 // nobody to wait for: just jump
+            pthread_cond_broadcast(&g_sim_cv);
+        } else {
+            // follow virtual time, but never block forever on a participant
+            // that is busy in something other than a sleep
+            struct timespec real;
+            clock_gettime(CLOCK_REALTIME, &real);
+            nsec_t until = ns_from_timespec(&real) + TB_SIM_PASSIVE_NS;
+            struct timespec ts = timespec_from_ns(until);
+            while (g_sim_now < deadline) {
+                if (pthread_cond_timedwait(&g_sim_cv, &g_sim_lock, &ts) == ETIMEDOUT) break;
+            }
+        }
+        pthread_mutex_unlock(&g_sim_lock);
+        return;
+    }
+
+    // attach caps participants at the slot count, so one is always free
+    int slot = 0;
+    while (g_sim_wake[slot]) ++slot;
+    g_sim_wake[slot] = deadline;
+    g_sim_asleep++;
+    sim_maybe_advance();
+    while (g_sim_now < deadline) pthread_cond_wait(&g_sim_cv, &g_sim_lock);
+    g_sim_wake[slot] = 0;
+    g_sim_asleep--;
+    pthread_mutex_unlock(&g_sim_lock);
+}
+
+int timebase_thread_attach(void)
+{
+    if (tl_participant) return 0;
+    pthread_mutex_lock(&g_sim_lock);
+    if (g_sim_participants >= TB_SIM_MAX_SLEEPERS) {
+        // two sharing a sleep slot would lose a deadline and stall the clock
+        pthread_mutex_unlock(&g_sim_lock);
+        fprintf(stderr, "timebase: all %d virtual-clock slots taken, thread only follows\n",
+                TB_SIM_MAX_SLEEPERS);
+        return -1;
+    }
+    tl_participant = true;
+    g_sim_participants++;
+    pthread_mutex_unlock(&g_sim_lock);
+    return 0;
+}
+
+void timebase_thread_detach(void)
+{
+    if (!tl_participant) return;
+    pthread_mutex_lock(&g_sim_lock);
+    tl_participant = false;
+    g_sim_participants--;
+    sim_maybe_advance();          // the rest may all be asleep already
+    pthread_mutex_unlock(&g_sim_lock);
+}
+
+bool timebase_is_virtual(void) { return true; }
+
+nsec_t wall_ns(void)
+{
+    static nsec_t base;              // real wall time at the first call
+    nsec_t v = timebase_sim_now();
+    pthread_mutex_lock(&g_sim_lock);
+    if (!base) {
+        struct timespec t;
+        clock_gettime(CLOCK_REALTIME, &t);
+        base = ns_from_timespec(&t) - (v - TB_SIM_START_NS);
+    }
+    pthread_mutex_unlock(&g_sim_lock);
+    return base + (v - TB_SIM_START_NS);
+}
+
+#else
+void sleep_until_ns(nsec_t deadline)
+{
+    struct timespec ts = timespec_from_ns(deadline);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        // signal: go back to sleep for the rest
+    }
+}
+
+int  timebase_thread_attach(void) { return 0; }
+void timebase_thread_detach(void) {}
+bool timebase_is_virtual(void) { return false; }
+
+nsec_t wall_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return ns_from_timespec(&t);
+}
+#endif
+
+void sleep_ns(nsec_t ns)
+{
+    if (ns <= 0) return;
+    sleep_until_ns(now_ns() + ns);
+}
+
+void sleep_ms(long long ms)
+{
+    sleep_ns(ms * NS_PER_MS);
+}
+
+nsec_t realtime_to_mono_ns(nsec_t realtime)
+{
+    // the wall clock can be stepped, so only the age is trusted; it also
+    // keeps working on the virtual clock
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return now_ns() - (ns_from_timespec(&t) - realtime);
+}
+
+nsec_t cycles_to_ns(uint64_t delta)
+{
+    // split so large deltas can't overflow the 64-bit product
+    uint64_t hi = delta >> TB_CYC_SHIFT;
+    uint64_t lo = delta & ((1ULL << TB_CYC_SHIFT) - 1);
+    return (nsec_t)(hi * g_cyc_mult + ((lo * g_cyc_mult) >> TB_CYC_SHIFT));
+}
+
+#ifndef TIMEBASE_SIM
+static double cost_of(nsec_t (*fn)(void))
+{
+    volatile nsec_t sink = 0;
+    nsec_t t0 = now_raw_ns();
+    for (int i = 0; i < TB_COST_LOOPS; ++i) sink += fn();
+    nsec_t dt = now_raw_ns() - t0;
+    (void)sink;
+    return (double)dt / TB_COST_LOOPS;
+}
+#endif
+
+int timebase_init(timebase_report_t *out)
+{
+    timebase_report_t r = {0};
+
+#ifdef TIMEBASE_SIM
+    // nothing to measure: reads are a locked load, cycles are virtual ns
+    timebase_thread_attach();
+    r.fast      = true;
+    r.cycles_hz = 1e9;
+#else
+    r.vdso = getauxval(AT_SYSINFO_EHDR) != 0;
+
+    struct timespec res;
+    if (clock_getres(CLOCK_MONOTONIC, &res) == 0) r.resolution_ns = res.tv_nsec;
+
+    (void)cost_of(now_ns);                  // warm caches / fault in the vDSO page
+    r.mono_ns_per_call = cost_of(now_ns);
+    r.raw_ns_per_call  = cost_of(now_raw_ns);
+    r.fast = r.vdso && r.mono_ns_per_call < TB_FAST_LIMIT_NS;
+
+#if defined(__aarch64__) || defined(__x86_64__) || defined(__i386__)
+    r.cycles_hw = true;
+    uint64_t c0 = cycles_now();
+    nsec_t   t0 = now_raw_ns();
+    sleep_ns(TB_CAL_WINDOW_NS);
+    uint64_t c1 = cycles_now();
+    nsec_t   t1 = now_raw_ns();
+    if (c1 > c0 && t1 > t0) {
+        r.cycles_hz = (double)(c1 - c0) * 1e9 / (double)(t1 - t0);
+        g_cyc_mult  = (uint64_t)(((double)(t1 - t0) / (double)(c1 - c0)) *
+                                 (double)(1ULL << TB_CYC_SHIFT) + 0.5);
+    }
+#else
+    r.cycles_hz = 1e9;
+#endif
+#endif  // TIMEBASE_SIM
+
+    if (out) *out = r;
+    return r.fast ? 0 : -1;
+}
+
+void timebase_print(const timebase_report_t *r, const char *tag)
+{
+    if (timebase_is_virtual()) {
+        printf("%s clock: VIRTUAL (simulation build)\n", tag);
+        return;
+    }
+    printf("%s clock: %.0f ns/read (%s), res %ld ns, cycle counter %s @ %.1f MHz\n",
+           tag, r->mono_ns_per_call,
+           r->fast ? "vDSO" : "SLOW: syscall fallback",
+           r->resolution_ns,
+           r->cycles_hw ? "hw" : "emulated",
+           r->cycles_hz / 1e6);
+}
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""
+fake_responder.py
+
+Stand-in inference host for trying hedged requests without cameras or a
+model: answers PING at once, and every START with --frames streamed
+FRAMEs, then a RESULT (echoing the host_id) plus TIMING, spread over a
+random delay. Now and then it "stalls" to play the slow box the Beagle
+should hedge around.
+
+Run one per port and point the Beagle at them:
+
+    python ml/fake_responder.py --port 6000
+    python ml/fake_responder.py --port 6001 --stall-prob 0.05 --stall-ms 4000
+    SORTER_HOSTS=192.168.7.1:6000,192.168.7.1:6001 ./sorter
+"""
+
+import argparse
+import random
+import socket
+import threading
+import time
+
+import sort_proto
+
+RESULT_PORT = 5005
+
+
+def answer(sock, addr, job_id, host_id, args, t_rx):
+    delay = args.delay_ms + random.uniform(-args.jitter_ms, args.jitter_ms)
+    if random.random() < args.stall_prob:
+        delay += args.stall_ms
+        print(f"[fake_responder:{args.port}] stalling job {job_id}")
+    labels = list(sort_proto.CLASS_IDS)
+    truth = random.choice(labels)
+    dest = (addr[0], RESULT_PORT)
+    votes = []
+    confs = []
+    for i in range(args.frames):
+        time.sleep(max(delay, 0) / 1000.0 / args.frames)
+        right = random.random() < args.frame_acc
+        label = truth if right else next(l for l in labels if l != truth)
+        conf = random.uniform(65, 99.9) if right else random.uniform(50, 80)
+        votes.append(label)
+        confs.append(conf)
+        sock.sendto(sort_proto.pack_frame(job_id, host_id, i, args.frames, label,
+                                          conf), dest)
+    if not args.frames:
+        time.sleep(max(delay, 0) / 1000.0)
+        votes.append(truth)
+        confs.append(0)
+
+    label = max(set(votes), key=votes.count)
+    conf = sum(c for l, c in zip(votes, confs) if l == label) / votes.count(label)
+    t_classified = sort_proto.now_ns()
+    sock.sendto(sort_proto.pack_result(job_id, host_id, label, conf), dest)
+    sock.sendto(sort_proto.pack(sort_proto.TIMING, job_id,
+                                t_rx, t_rx, t_classified), dest)
+    print(f"[fake_responder:{args.port}] job {job_id} -> {label} {conf:.1f}% ({delay:.0f} ms)")
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--port", type=int, default=6000)
+    ap.add_argument("--delay-ms", type=float, default=1200)
+    ap.add_argument("--jitter-ms", type=float, default=200)
+    ap.add_argument("--stall-prob", type=float, default=0.0)
+    ap.add_argument("--stall-ms", type=float, default=4000)
+    ap.add_argument("--frames", type=int, default=3, help="0 = result only")
+    ap.add_argument("--frame-acc", type=float, default=0.9)
+    args = ap.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("0.0.0.0", args.port))
+    print(f"[fake_responder] Listening on UDP {args.port}...")
+
+    while True:
+        data, addr = sock.recvfrom(1024)
+        t_rx = sort_proto.now_ns()
+        msg = sort_proto.parse(data)
+        if msg is None:
+            continue
+        msg_type, job_id, stamps = msg
+        if msg_type == sort_proto.PING:
+            sock.sendto(sort_proto.pong(job_id, stamps, t_rx), addr)
+        elif msg_type == sort_proto.START:
+            threading.Thread(target=answer, daemon=True,
+                             args=(sock, addr, job_id, stamps[0], args, t_rx)).start()
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except KeyboardInterrupt:
+        pass
@@ -3,6 +3,9 @@ import socket
 import subprocess
 import sys
 import os
+import threading
+
+import sort_proto
 
 # Ensure we run from the Project root: /home/gavinbell/Project
 PROJECT_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
@@ -10,6 +13,7 @@ os.chdir(PROJECT_ROOT)
 
 LISTEN_IP = "0.0.0.0"
 LISTEN_PORT = 6000  # Beagle sends "start" here
+RESULT_PORT = 5005  # and listens for the result here
 
 def run_cmd(cmd):
     print(f"[host_main_server] Running: {' '.join(cmd)}")
@@ -19,36 +23,81 @@ def run_cmd(cmd):
         return False
     return True
 
+def run_pipeline(sock, addr, job_id, host_id):
+    """Capture + ML + UDP send. job_id is None for a text 'start'."""
+    t_rx = sort_proto.now_ns()
+
+    # 1) Take 3 photos
+    if not run_cmd(["python", "ml/capture_three_photos_vm.py"]):
+        print("[host_main_server] Skipping ML step due to capture error.")
+        return
+    t_captured = sort_proto.now_ns()
+
+    # 2) Run prediction + send result to Beagle
+    #    This assumes predict_and_send_udp.py:
+    #      - loads paper_plastic_model_2.keras
+    #      - does best-of-3 on Project/images
+    #      - sends 'paper' or 'plastic' to Beagle:5005
+    #    For a binary start it answers with a RESULT echoing our host id,
+    #    sent back to whoever asked (the Beagle may be hedging over hosts).
+    cmd = ["python", "ml/predict_and_send_udp.py"]
+    if job_id is not None:
+        cmd += ["--job", str(job_id), "--host-id", str(host_id),
+                "--reply", f"{addr[0]}:{RESULT_PORT}"]
+    if not run_cmd(cmd):
+        print("[host_main_server] ML/UDP send step failed.")
+        return
+    t_classified = sort_proto.now_ns()
+
+    # 3) Stage times so the Beagle can split its latency
+    if job_id is not None:
+        sock.sendto(sort_proto.pack(sort_proto.TIMING, job_id,
+                                    t_rx, t_captured, t_classified), addr)
+
+    print("[host_main_server] Pipeline finished for this start request.")
+
+
 def main():
     sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
     sock.bind((LISTEN_IP, LISTEN_PORT))
     print(f"[host_main_server] Listening for 'start' on UDP {LISTEN_PORT}...")
 
+    # The pipeline runs on a worker thread so pings keep getting answered
+    # (and timestamped) while photos are taken and the model runs.
+    worker = None
+
     while True:
         data, addr = sock.recvfrom(1024)
-        msg = data.decode(errors="ignore").strip().lower()
-        print(f"[host_main_server] Received '{msg}' from {addr}")
-
-        if msg == "start":
-            print("[host_main_server] Triggering capture + ML + UDP send...")
+        t_rx = sort_proto.now_ns()
 
-            # 1) Take 3 photos
-            if not run_cmd(["python", "ml/capture_three_photos_vm.py"]):
-                print("[host_main_server] Skipping ML step due to capture error.")
+        msg = sort_proto.parse(data)
+        if msg is not None:
+            msg_type, job_id, stamps = msg
+            host_id = stamps[0]
+            if msg_type == sort_proto.PING:
+                sock.sendto(sort_proto.pong(job_id, stamps, t_rx), addr)
                 continue
-
-            # 2) Run prediction + send result to Beagle
-            #    This assumes predict_and_send_udp.py:
-            #      - loads paper_plastic_model_2.keras
-            #      - does best-of-3 on Project/images
-            #      - sends 'paper' or 'plastic' to Beagle:5005
-            if not run_cmd(["python", "ml/predict_and_send_udp.py"]):
-                print("[host_main_server] ML/UDP send step failed.")
+            if msg_type != sort_proto.START:
+                print(f"[host_main_server] Ignoring message type {msg_type}")
                 continue
-
-            print("[host_main_server] Pipeline finished for this start request.")
+            print(f"[host_main_server] Received start (job {job_id}) from {addr}")
         else:
-            print("[host_main_server] Ignoring unknown command")
+            text = data.decode(errors="ignore").strip().lower()
+            print(f"[host_main_server] Received '{text}' from {addr}")
+            if text != "start":
+                print("[host_main_server] Ignoring unknown command")
+                continue
+            job_id = None
+            host_id = 0
+
+        if worker is not None and worker.is_alive():
+            print("[host_main_server] Still busy with the last item, ignoring start.")
+            continue
+
+        print("[host_main_server] Triggering capture + ML + UDP send...")
+        worker = threading.Thread(target=run_pipeline, args=(sock, addr, job_id, host_id),
+                                  daemon=True)
+        worker.start()
 
 if __name__ == "__main__":
     try:
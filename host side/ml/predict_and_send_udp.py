@@ -5,6 +5,10 @@ predict_and_send_udp.py
 - Runs TFLite best-of-3 on images/ (same logic as your working script).
 - Computes majority vote: "paper" or "plastic".
 - Sends JUST that word via UDP to the Beagle.
+- With --job (set by host_main_server.py for binary starts) it sends a
+  binary RESULT instead, echoing --host-id, to --reply ip:port, and
+  streams a FRAME per photo as soon as it is classified so the Beagle
+  can move the servo once the vote is decided.
 
 Run from Project/:
 
@@ -12,6 +16,7 @@ Run from Project/:
     python ml/predict_and_send_udp.py
 """
 
+import argparse
 import os
 from collections import Counter
 import socket
@@ -20,6 +25,8 @@ import numpy as np
 import tensorflow as tf
 from tensorflow.keras.applications import efficientnet
 
+import sort_proto
+
 # ----------------------- CONFIG -----------------------
 
 # EfficientNet preprocessing (same as training)
@@ -94,16 +101,32 @@ def predict_single(interpreter, img_path):
     return label, conf, probs
 
 
-def send_udp(msg: str):
-    """Send the final label ('paper' or 'plastic') to Beagle."""
+def send_udp(payload, dest=(BEAGLE_IP, BEAGLE_PORT)):
+    """Send the final label ('paper' or 'plastic', or a RESULT) to Beagle."""
+    if isinstance(payload, str):
+        payload = payload.encode("utf-8")
     sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
     try:
-        sock.sendto(msg.encode("utf-8"), (BEAGLE_IP, BEAGLE_PORT))
+        sock.sendto(payload, dest)
     finally:
         sock.close()
 
 
+def parse_args():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--job", type=int, help="job id of a binary start")
+    ap.add_argument("--host-id", type=int, default=0)
+    ap.add_argument("--reply", help="ip:port to send the result to")
+    return ap.parse_args()
+
+
 def main():
+    args = parse_args()
+    dest = (BEAGLE_IP, BEAGLE_PORT)
+    if args.reply:
+        ip, port = args.reply.rsplit(":", 1)
+        dest = (ip, int(port))
+
     interpreter = load_interpreter()
 
     # Get first 3 images
@@ -128,10 +151,15 @@ def main():
     print("-----------------------")
 
     votes = []
+    confs = []
 
-    for p in paths:
+    for i, p in enumerate(paths):
         label, conf, probs = predict_single(interpreter, p)
         votes.append(label)
+        confs.append(conf)
+        if args.job is not None:
+            send_udp(sort_proto.pack_frame(args.job, args.host_id, i, len(paths),
+                                           label, conf), dest)
         probs_str = ", ".join(
             f"{class_names[i]}={probs[i]:.3f}" for i in range(len(class_names))
         )
@@ -139,12 +167,18 @@ def main():
 
     # Majority vote
     winner = Counter(votes).most_common(1)[0][0]
+    # the Beagle rejects the item if this is under its threshold
+    winner_conf = float(np.mean([c for l, c in zip(votes, confs) if l == winner]))
 
-    print("\nBest-of-3 result:", winner)
+    print(f"\nBest-of-3 result: {winner} ({winner_conf:.1f}%)")
 
     # Send to Beagle
-    print(f"Sending '{winner}' to {BEAGLE_IP}:{BEAGLE_PORT} via UDP...")
-    send_udp(winner)
+    print(f"Sending '{winner}' to {dest[0]}:{dest[1]} via UDP...")
+    if args.job is not None:
+        send_udp(sort_proto.pack_result(args.job, args.host_id, winner, winner_conf),
+                 dest)
+    else:
+        send_udp(winner, dest)
     print("Done.\n")
 
 
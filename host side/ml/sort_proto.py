@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""
+sort_proto.py
+
+Binary datagrams shared with the Beagle (mirror of
+beagle side/app/include/sort_proto.h). Little-endian, fixed size.
+
+Anything that doesn't start with the magic is the old text protocol
+("start", "paper", "plastic"), so old and new scripts can be mixed.
+
+Host timestamps are time.monotonic_ns(); the Beagle estimates the offset
+to its own clock from ping/pong.
+
+Class ids come from the same class-table file the Beagle loads
+(SORTER_CLASSES, see class_table.h); without it, the Beagle's built-in
+paper/plastic table.
+"""
+
+import os
+import struct
+import time
+
+MAGIC = 0x5354
+VERSION = 1
+
+START = 1    # Beagle -> host: begin capture + classification
+PING = 2     # Beagle -> host: t1
+PONG = 3     # host -> Beagle: t1 echoed, t2 = received, t3 = sent
+TIMING = 4   # host -> Beagle: t_rx, t_captured, t_classified
+RESULT = 5   # host -> Beagle: host_id echoed from START, class, confidence
+FRAME = 6    # host -> Beagle: one photo's class + confidence, streamed
+
+# class_table_default() on the Beagle
+DEFAULT_CLASS_IDS = {"paper": 1, "plastic": 2}
+CLASS_MAX = 32
+
+
+def load_class_ids(path):
+    """name -> wire id from a class-table file ("id name min_conf ...").
+
+    Id 0 is the Beagle's reject action, not something a model reports,
+    so it is left out (unknown labels are sent as 0 anyway).
+    """
+    ids = {}
+    with open(path) as f:
+        for lineno, line in enumerate(f, 1):
+            tok = line.split("#", 1)[0].split()
+            if not tok:
+                continue
+            if len(tok) < 2 or not tok[0].isdigit() or int(tok[0]) >= CLASS_MAX:
+                raise ValueError(f"{path}:{lineno}: bad class line")
+            if int(tok[0]) != 0:
+                ids[tok[1]] = int(tok[0])
+    return ids
+
+
+CLASS_IDS = (load_class_ids(os.environ["SORTER_CLASSES"])
+             if os.environ.get("SORTER_CLASSES") else DEFAULT_CLASS_IDS)
+
+HDR = struct.Struct("<HBBI")       # magic, version, type, job_id
+STAMPS = struct.Struct("<qqq")     # body of PING/PONG and TIMING
+START_BODY = struct.Struct("<B3x")     # host_id
+RESULT_BODY = struct.Struct("<BBH")    # host_id, class, confidence (per mille)
+FRAME_BODY = struct.Struct("<BBBBH2xq")   # host_id, frame, n_frames, class,
+                                          # confidence (per mille), t_sent
+
+
+def now_ns():
+    return time.monotonic_ns()
+
+
+def pack(msg_type, job_id, a=0, b=0, c=0):
+    return HDR.pack(MAGIC, VERSION, msg_type, job_id) + STAMPS.pack(a, b, c)
+
+
+def pack_start(job_id, host_id):
+    return HDR.pack(MAGIC, VERSION, START, job_id) + START_BODY.pack(host_id)
+
+
+def pack_result(job_id, host_id, label, conf_pct=0):
+    """conf_pct 0 = not reported; the Beagle then sorts without a threshold."""
+    return (HDR.pack(MAGIC, VERSION, RESULT, job_id) +
+            RESULT_BODY.pack(host_id, CLASS_IDS.get(label, 0),
+                             int(round(conf_pct * 10))))
+
+
+def pack_frame(job_id, host_id, frame, n_frames, label, conf_pct):
+    """One classified photo; label None = no idea."""
+    cls = CLASS_IDS.get(label, 0)
+    return (HDR.pack(MAGIC, VERSION, FRAME, job_id) +
+            FRAME_BODY.pack(host_id, frame, n_frames, cls,
+                            int(round(conf_pct * 10)), now_ns()))
+
+
+def parse(data):
+    """Returns (type, job_id, (a, b, c)) or None for non-protocol data.
+
+    For START the body is (host_id, 0, 0); the host_id has to be echoed
+    back in the RESULT so the Beagle knows which of its hosts answered.
+    """
+    if len(data) < HDR.size:
+        return None
+    magic, version, msg_type, job_id = HDR.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        return None
+    stamps = (0, 0, 0)
+    if msg_type == START and len(data) >= HDR.size + START_BODY.size:
+        stamps = (START_BODY.unpack_from(data, HDR.size)[0], 0, 0)
+    elif len(data) >= HDR.size + STAMPS.size:
+        stamps = STAMPS.unpack_from(data, HDR.size)
+    return msg_type, job_id, stamps
+
+
+def pong(job_id, stamps, t_rx):
+    """Reply to a PING (job_id, stamps) that was received at t_rx."""
+    return pack(PONG, job_id, stamps[0], t_rx, now_ns())